@@ -6,6 +6,7 @@
 #include <linux/mm.h>
 #include <linux/sched.h>
 #include <linux/spinlock.h>
+#include <linux/sched/mm.h>
 #include <asm/mmu.h>	
 #include <asm/cputable.h>
 #include <asm/cputhreads.h>
@@ -90,6 +91,17 @@ static inline void switch_mm(struct mm_struct *prev, struct mm_struct *next,
 	if (prev == next)
 		return;
 
+#ifdef CONFIG_MEMBARRIER
+	/*
+	 * MEMBARRIER_CMD_PRIVATE_EXPEDITED needs a full barrier between
+	 * the store to rq->curr and the return to user space, and the
+	 * spin_unlock() in finish_lock_switch() is only a RELEASE.
+	 */
+	if (atomic_read(&next->membarrier_state) &
+	    MEMBARRIER_STATE_PRIVATE_EXPEDITED)
+		smp_mb();
+#endif
+
 #ifdef CONFIG_PPC_ICSWX
 	/* Switch coprocessor context only if prev or next uses a coprocessor */
 	if (prev->context.acop || next->context.acop)
@@ -740,7 +740,13 @@ static inline pte_t *pte_offset_kernel(pmd_t *pmd, unsigned long address)
 
 static inline int pmd_bad(pmd_t pmd)
 {
+#ifdef CONFIG_LAZY_FORK_PGTABLES
+	/* pte tables shared on fork are mapped read-only */
+	return (pmd_flags(pmd) & ~(_PAGE_USER | _PAGE_RW)) !=
+		(_KERNPG_TABLE & ~_PAGE_RW);
+#else
 	return (pmd_flags(pmd) & ~_PAGE_USER) != _KERNPG_TABLE;
+#endif
 }
 
 static inline unsigned long pages_to_mb(unsigned long npg)
@@ -256,6 +256,9 @@ static int gup_pmd_range(pud_t pud, unsigned long addr, unsigned long end,
 			if (!gup_huge_pmd(pmd, addr, next, write, pages, nr))
 				return 0;
 		} else {
+			/* pte table shared on fork, see pte_table_unshare() */
+			if (write && !(pmd_flags(pmd) & _PAGE_RW))
+				return 0;
 			if (!gup_pte_range(pmd, addr, next, write, pages, nr))
 				return 0;
 		}
@@ -529,6 +529,29 @@ int driver_probe_device(struct device_driver *drv, struct device *dev)
 	return ret;
 }
 
+/*
+ * driver_async_probe= takes a comma separated list of drivers to probe
+ * asynchronously, or "*" for all of them, save for those which have to
+ * probe synchronously.
+ */
+#define ASYNC_PROBE_NAMES_LEN	256
+static char async_probe_names[ASYNC_PROBE_NAMES_LEN];
+
+static int __init async_probe_setup(char *str)
+{
+	if (strlcpy(async_probe_names, str, sizeof(async_probe_names)) >=
+	    sizeof(async_probe_names))
+		pr_warn("driver_async_probe= list truncated\n");
+	return 1;
+}
+__setup("driver_async_probe=", async_probe_setup);
+
+static bool cmdline_requested_async_probing(const char *name)
+{
+	return parse_option_str(async_probe_names, "*") ||
+	       parse_option_str(async_probe_names, name);
+}
+
 bool driver_allows_async_probing(struct device_driver *drv)
 {
 	switch (drv->probe_type) {
@@ -542,6 +565,9 @@ bool driver_allows_async_probing(struct device_driver *drv)
 		if (module_requested_async_probing(drv->owner))
 			return true;
 
+		if (cmdline_requested_async_probing(drv->name))
+			return true;
+
 		return false;
 	}
 }
@@ -20,6 +20,7 @@ extern void cpuidle_install_idle_handler(void);
 extern void cpuidle_uninstall_idle_handler(void);
 
 /* governors */
+extern char param_governor[];
 extern int cpuidle_switch_governor(struct cpuidle_governor *gov);
 
 /* sysfs */
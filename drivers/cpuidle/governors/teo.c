@@ -0,0 +1,316 @@
+/*
+ * teo.c - the timer events oriented idle governor
+ *
+ * This code is licenced under the GPL version 2 as described
+ * in the COPYING file that acompanies the Linux Kernel.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos.h>
+#include <linux/ktime.h>
+#include <linux/tick.h>
+#include <linux/sched.h>
+#include <linux/cpu.h>
+
+/*
+ * Concepts and ideas behind the TEO governor
+ *
+ * On servers running latency sensitive request/response workloads the CPUs
+ * go idle very often, but mostly for short times, and they are woken up by
+ * interrupts (network, IPIs) rather than by timers.  Predictions built on
+ * correction factors applied to the next timer event tend to overshoot
+ * there, and every overshoot into a deep state costs its exit latency on
+ * the next request.
+ *
+ * The next timer event is the only wakeup source known for sure, so TEO
+ * starts from it: it is an upper bound for the idle duration.  The idle
+ * state matching it ("the timer state") is the deepest one whose target
+ * residency fits in the time till the next timer.
+ *
+ * After every wakeup, the idle duration actually measured is compared with
+ * the sleep length seen before entering the state:
+ *
+ *  - If the CPU woke up close to the timer, or at least late enough for
+ *    the timer state to have paid off, that was a "hit" of the timer state.
+ *
+ *  - Otherwise something else woke the CPU up early: that was a "miss" of
+ *    the timer state, and an "early hit" of the state matching the
+ *    measured idle duration.
+ *
+ * All three metrics decay, so they follow recent history rather than the
+ * long term average.  On idle entry, the timer state is used if its hits
+ * outweigh its misses.  If not, early wakeups are likely to happen again,
+ * and the shallower state with the most early hits is used instead.
+ *
+ * Finally, the most recent idle durations are kept: if most of them were
+ * shorter than the chosen state's target residency, their average is used
+ * to go shallower still.  This catches steady streams of short idle
+ * periods, which the decaying metrics only pick up with some delay.
+ */
+
+/* Fraction of the metrics dropped on every update */
+#define DECAY_SHIFT	3
+
+/* Amount added to a metric on every update */
+#define PULSE		1024
+
+/* Number of recent idle durations taken into account */
+#define INTERVALS	8
+
+/*
+ * A wakeup this close to the timer, in microseconds, is considered caused
+ * by it.
+ */
+#define TIMER_MARGIN	10
+
+/**
+ * struct teo_idle_state - wakeup statistics of an idle state
+ * @early_hits: idle periods ending early, in range of the state
+ * @hits: idle periods for which the state was the timer state and fitted
+ * @misses: idle periods for which the state was the timer state, but
+ *	    ended too early
+ */
+struct teo_idle_state {
+	unsigned int early_hits;
+	unsigned int hits;
+	unsigned int misses;
+};
+
+/**
+ * struct teo_cpu - per-CPU data of the governor
+ * @sleep_length_us: time till the next timer event at the last idle entry
+ * @last_state_idx: idle state entered last
+ * @needs_update: the statistics haven't been updated since the last wakeup
+ * @states: per state wakeup statistics
+ * @interval_idx: next slot to use in @intervals
+ * @intervals: most recent measured idle durations, UINT_MAX for timer
+ *	       wakeups
+ */
+struct teo_cpu {
+	unsigned int sleep_length_us;
+	int last_state_idx;
+	int needs_update;
+	struct teo_idle_state states[CPUIDLE_STATE_MAX];
+	int interval_idx;
+	unsigned int intervals[INTERVALS];
+};
+
+static DEFINE_PER_CPU(struct teo_cpu, teo_cpus);
+
+static bool teo_state_enabled(struct cpuidle_driver *drv,
+			      struct cpuidle_device *dev, int i)
+{
+	return !drv->states[i].disabled && !dev->states_usage[i].disable;
+}
+
+/**
+ * teo_update - update the statistics after a wakeup
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ */
+static void teo_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
+{
+	struct teo_cpu *cpu_data = this_cpu_ptr(&teo_cpus);
+	struct cpuidle_state *target = &drv->states[cpu_data->last_state_idx];
+	unsigned int sleep_length_us = cpu_data->sleep_length_us;
+	unsigned int measured_us;
+	int i, idx_timer = 0, idx_hit = 0;
+	bool timer_wakeup;
+
+	/*
+	 * The measured time includes the exit latency, which we are not
+	 * interested in; the same approximation as in the menu governor.
+	 */
+	measured_us = cpuidle_get_last_residency(dev);
+	if (measured_us > 2 * target->exit_latency)
+		measured_us -= target->exit_latency;
+	else
+		measured_us /= 2;
+
+	/* Decay the metrics and find the states matching the durations */
+	for (i = 0; i < drv->state_count; i++) {
+		struct teo_idle_state *st = &cpu_data->states[i];
+		unsigned int residency = drv->states[i].target_residency;
+
+		st->early_hits -= st->early_hits >> DECAY_SHIFT;
+		st->hits -= st->hits >> DECAY_SHIFT;
+		st->misses -= st->misses >> DECAY_SHIFT;
+
+		if (residency <= sleep_length_us)
+			idx_timer = i;
+		if (residency <= measured_us)
+			idx_hit = i;
+	}
+
+	timer_wakeup = measured_us + TIMER_MARGIN >= sleep_length_us;
+	if (timer_wakeup || idx_hit == idx_timer) {
+		cpu_data->states[idx_timer].hits += PULSE;
+	} else {
+		cpu_data->states[idx_timer].misses += PULSE;
+		cpu_data->states[idx_hit].early_hits += PULSE;
+	}
+
+	/* only early wakeups tell us something about short idle periods */
+	cpu_data->intervals[cpu_data->interval_idx++] =
+		timer_wakeup ? UINT_MAX : measured_us;
+	if (cpu_data->interval_idx >= INTERVALS)
+		cpu_data->interval_idx = 0;
+}
+
+/**
+ * teo_select - selects the next idle state to enter
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ */
+static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev)
+{
+	struct teo_cpu *cpu_data = this_cpu_ptr(&teo_cpus);
+	struct device *device = get_cpu_device(dev->cpu);
+	int latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
+	int resume_latency = dev_pm_qos_raw_read_value(device);
+	unsigned int hits = 0, misses = 0, early_hits = 0;
+	unsigned int duration_us, count = 0;
+	int i, idx = -1, max_early_idx = -1;
+	u64 sum = 0;
+
+	if (cpu_data->needs_update) {
+		teo_update(drv, dev);
+		cpu_data->needs_update = 0;
+	}
+
+	/* resume_latency is 0 means no restriction */
+	if (resume_latency && resume_latency < latency_req)
+		latency_req = resume_latency;
+
+	cpu_data->sleep_length_us = ktime_to_us(tick_nohz_get_sleep_length());
+	duration_us = cpu_data->sleep_length_us;
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0))
+		goto out;
+
+	/* Find the timer state and the one with the most early hits */
+	for (i = CPUIDLE_DRIVER_STATE_START; i < drv->state_count; i++) {
+		struct cpuidle_state *s = &drv->states[i];
+		struct teo_idle_state *st = &cpu_data->states[i];
+
+		if (!teo_state_enabled(drv, dev, i))
+			continue;
+		if (s->target_residency > duration_us ||
+		    s->exit_latency > latency_req)
+			break;
+
+		idx = i;
+		hits = st->hits;
+		misses = st->misses;
+
+		if (st->early_hits >= early_hits) {
+			early_hits = st->early_hits;
+			max_early_idx = i;
+		}
+	}
+
+	/*
+	 * None of the real states fits, poll if the timer is really close or
+	 * the latency constraint is too tight for anything else.
+	 */
+	if (idx < 0) {
+		idx = CPUIDLE_DRIVER_STATE_START - 1;
+		goto out;
+	}
+
+	/*
+	 * Use the timer state if it has been hit more often than missed.
+	 * Otherwise early wakeups are likely, so use the state which has
+	 * seen the most of them.
+	 */
+	if (hits <= misses && max_early_idx >= 0 && max_early_idx < idx) {
+		idx = max_early_idx;
+		duration_us = drv->states[idx].target_residency;
+	}
+
+	/*
+	 * If most of the recent idle periods were shorter than that, their
+	 * average is a better guess.
+	 */
+	for (i = 0; i < INTERVALS; i++) {
+		unsigned int val = cpu_data->intervals[i];
+
+		if (val >= duration_us)
+			continue;
+		count++;
+		sum += val;
+	}
+
+	if (count > INTERVALS / 2) {
+		unsigned int avg_us = div64_u64(sum, count);
+
+		/* Only go shallower if the state selected so far overshoots */
+		if (drv->states[idx].target_residency > avg_us) {
+			for (i = idx - 1; i >= CPUIDLE_DRIVER_STATE_START; i--) {
+				if (!teo_state_enabled(drv, dev, i))
+					continue;
+				idx = i;
+				if (drv->states[i].target_residency <= avg_us)
+					break;
+			}
+		}
+	}
+
+out:
+	if (idx < 0)
+		idx = 0;
+	cpu_data->last_state_idx = idx;
+	return idx;
+}
+
+/**
+ * teo_reflect - records that the statistics need an update
+ * @dev: the CPU
+ * @index: the index of actual entered state
+ *
+ * NOTE: it's important to be fast here because this operation will add to
+ *       the overall exit latency.
+ */
+static void teo_reflect(struct cpuidle_device *dev, int index)
+{
+	struct teo_cpu *cpu_data = this_cpu_ptr(&teo_cpus);
+
+	cpu_data->last_state_idx = index;
+	cpu_data->needs_update = 1;
+}
+
+/**
+ * teo_enable_device - initialize the governor's data for the CPU
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static int teo_enable_device(struct cpuidle_driver *drv,
+			     struct cpuidle_device *dev)
+{
+	struct teo_cpu *cpu_data = &per_cpu(teo_cpus, dev->cpu);
+	int i;
+
+	memset(cpu_data, 0, sizeof(*cpu_data));
+
+	for (i = 0; i < INTERVALS; i++)
+		cpu_data->intervals[i] = UINT_MAX;
+
+	return 0;
+}
+
+static struct cpuidle_governor teo_governor = {
+	.name =		"teo",
+	.rating =	19,
+	.enable =	teo_enable_device,
+	.select =	teo_select,
+	.reflect =	teo_reflect,
+};
+
+static int __init teo_governor_init(void)
+{
+	return cpuidle_register_governor(&teo_governor);
+}
+
+postcore_initcall(teo_governor_init);
@@ -950,6 +950,9 @@ static int clear_refs_pte_range(pmd_t *pmd, unsigned long addr,
 
 	if (pmd_trans_unstable(pmd))
 		return 0;
+	/* shared with another mm, which has its own soft-dirty bits */
+	if (pmd_shared_pgtable(*pmd))
+		return 0;
 
 	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
 	for (; addr != end; pte++, addr += PAGE_SIZE) {
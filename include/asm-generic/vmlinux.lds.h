@@ -698,6 +698,7 @@
 #define INIT_CALLS_LEVEL(level)						\
 		VMLINUX_SYMBOL(__initcall##level##_start) = .;		\
 		KEEP(*(.initcall##level##.init))			\
+		VMLINUX_SYMBOL(__initcall##level##s_start) = .;		\
 		KEEP(*(.initcall##level##s.init))			\
 
 #define INIT_CALLS							\
@@ -16,6 +16,18 @@
 #define BPF_REGISTER_MAX_RANGE (1024 * 1024 * 1024)
 #define BPF_REGISTER_MIN_RANGE -1
 
+/* Liveness marks, used for state pruning.
+ * A register or stack slot is READ in an explored state if some path from
+ * that state reads it before writing it; states that differ only in slots
+ * nobody reads are equivalent. WRITTEN in the current state screens reads
+ * further down from propagating up to the parent state.
+ */
+enum bpf_reg_liveness {
+	REG_LIVE_NONE = 0,	/* not read or written since parent state */
+	REG_LIVE_READ = 1,	/* value of the parent state is needed */
+	REG_LIVE_WRITTEN = 2,	/* overwritten, later reads don't go up */
+};
+
 struct bpf_reg_state {
 	enum bpf_reg_type type;
 	union {
@@ -34,6 +46,10 @@ struct bpf_reg_state {
 		struct bpf_map *map_ptr;
 	};
 	u32 id;
+	/* Not part of the register value, states_equal() compares the
+	 * fields above it and the range below separately.
+	 */
+	enum bpf_reg_liveness live;
 	/* Used to determine if any memory access using this register will
 	 * result in a bad access. These two fields must be last.
 	 * See states_equal()
@@ -55,7 +71,12 @@ enum bpf_stack_slot_type {
  */
 struct bpf_verifier_state {
 	struct bpf_reg_state regs[MAX_BPF_REG];
+	/* explored state this one continues from, see mark_reg_read() */
+	struct bpf_verifier_state *parent;
 	u8 stack_slot_type[MAX_BPF_STACK];
+	/* live marks of spilled_regs[] cover the whole slot, whatever
+	 * stack_slot_type[] says
+	 */
 	struct bpf_reg_state spilled_regs[MAX_BPF_STACK / BPF_REG_SIZE];
 };
 
@@ -55,6 +55,11 @@ union futex_key {
 #ifdef CONFIG_FUTEX
 extern void exit_robust_list(struct task_struct *curr);
 extern void exit_pi_state_list(struct task_struct *curr);
+extern void futex_mm_init(struct mm_struct *mm);
+extern void futex_mm_free(struct mm_struct *mm);
+extern void futex_mm_clone_thread(struct mm_struct *mm);
+extern int futex_hash_prctl_set(unsigned long slots);
+extern int futex_hash_prctl_get(void);
 #ifdef CONFIG_HAVE_FUTEX_CMPXCHG
 #define futex_cmpxchg_enabled 1
 #else
@@ -67,5 +72,22 @@ static inline void exit_robust_list(struct task_struct *curr)
 static inline void exit_pi_state_list(struct task_struct *curr)
 {
 }
+static inline void futex_mm_init(struct mm_struct *mm)
+{
+}
+static inline void futex_mm_free(struct mm_struct *mm)
+{
+}
+static inline void futex_mm_clone_thread(struct mm_struct *mm)
+{
+}
+static inline int futex_hash_prctl_set(unsigned long slots)
+{
+	return -EINVAL;
+}
+static inline int futex_hash_prctl_get(void)
+{
+	return -EINVAL;
+}
 #endif
 #endif
@@ -116,6 +116,7 @@ typedef void (*ctor_fn_t)(void);
 
 /* Defined in init/main.c */
 extern int do_one_initcall(initcall_t fn);
+extern int schedule_async_initcall(initcall_t fn);
 extern char __initdata boot_command_line[];
 extern char *saved_command_line;
 extern unsigned int reset_devices;
@@ -195,6 +196,28 @@ extern bool initcall_debug;
 #define late_initcall(fn)		__define_initcall(fn, 7)
 #define late_initcall_sync(fn)		__define_initcall(fn, 7s)
 
+/*
+ * The _async variants run the initcall from the async machinery, in
+ * parallel with the other initcalls of the level.  It is still waited for
+ * before the _sync initcalls of its level run, so it may only depend on
+ * earlier levels, and only the _sync initcalls of its level and later
+ * levels may depend on it.
+ */
+#define __define_async_initcall(fn, id)				\
+	static int __init __async_initcall_##fn(void)		\
+	{							\
+		return schedule_async_initcall(fn);		\
+	}							\
+	__define_initcall(__async_initcall_##fn, id)
+
+#define core_initcall_async(fn)		__define_async_initcall(fn, 1)
+#define postcore_initcall_async(fn)	__define_async_initcall(fn, 2)
+#define arch_initcall_async(fn)		__define_async_initcall(fn, 3)
+#define subsys_initcall_async(fn)	__define_async_initcall(fn, 4)
+#define fs_initcall_async(fn)		__define_async_initcall(fn, 5)
+#define device_initcall_async(fn)	__define_async_initcall(fn, 6)
+#define late_initcall_async(fn)		__define_async_initcall(fn, 7)
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn)						\
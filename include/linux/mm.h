@@ -1235,6 +1235,44 @@ void free_pgd_range(struct mmu_gather *tlb, unsigned long addr,
 		unsigned long end, unsigned long floor, unsigned long ceiling);
 int copy_page_range(struct mm_struct *dst, struct mm_struct *src,
 			struct vm_area_struct *vma);
+#ifdef CONFIG_LAZY_FORK_PGTABLES
+/*
+ * A pte table shared with another mm on fork is mapped read-only at the pmd
+ * level, so that writes through it fault, until it is unshared again.
+ */
+static inline bool pmd_shared_pgtable(pmd_t pmd)
+{
+	return pmd_present(pmd) && !pmd_trans_huge(pmd) && !pmd_devmap(pmd) &&
+	       !pmd_write(pmd);
+}
+int pte_table_unshare(struct vm_area_struct *vma, pmd_t *pmd,
+		      unsigned long addr);
+int pte_table_unshare_killable(struct vm_area_struct *vma, pmd_t *pmd,
+			       unsigned long addr);
+int unshare_partial_pte_tables(struct mm_struct *mm, unsigned long start,
+			       unsigned long end);
+#else
+static inline bool pmd_shared_pgtable(pmd_t pmd)
+{
+	return false;
+}
+static inline int pte_table_unshare(struct vm_area_struct *vma, pmd_t *pmd,
+				    unsigned long addr)
+{
+	return 0;
+}
+static inline int pte_table_unshare_killable(struct vm_area_struct *vma,
+					     pmd_t *pmd, unsigned long addr)
+{
+	return 0;
+}
+static inline int unshare_partial_pte_tables(struct mm_struct *mm,
+					     unsigned long start,
+					     unsigned long end)
+{
+	return 0;
+}
+#endif
 void unmap_mapping_range(struct address_space *mapping,
 		loff_t const holebegin, loff_t const holelen, int even_cows);
 int follow_pte_pmd(struct mm_struct *mm, unsigned long address,
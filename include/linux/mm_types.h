@@ -59,6 +59,11 @@ struct page {
 		pgoff_t index;		/* Our offset within mapping. */
 		void *freelist;		/* sl[aou]b first free object */
 		/* page_deferred_list().prev	-- second tail page */
+#ifdef CONFIG_LAZY_FORK_PGTABLES
+		atomic_t pt_share_count;	/* mms sharing a pte table,
+						 * see pte_table_unshare()
+						 */
+#endif
 	};
 
 	union {
@@ -396,6 +401,15 @@ struct mm_struct {
 	 */
 	atomic_t mm_count;
 
+#ifdef CONFIG_MEMBARRIER
+	/**
+	 * @membarrier_state: MEMBARRIER_STATE_* flags, see
+	 * <linux/sched/mm.h>. Inherited on fork, reset on exec with the
+	 * new mm.
+	 */
+	atomic_t membarrier_state;
+#endif
+
 	atomic_long_t nr_ptes;			/* PTE page table pages */
 #if CONFIG_PGTABLE_LEVELS > 2
 	atomic_long_t nr_pmds;			/* PMD page table pages */
@@ -498,6 +512,10 @@ struct mm_struct {
 	struct uprobes_state uprobes_state;
 #ifdef CONFIG_HUGETLB_PAGE
 	atomic_long_t hugetlb_usage;
+#endif
+#ifdef CONFIG_FUTEX
+	/* hash for PROCESS_PRIVATE futexes, NULL while using the global one */
+	struct futex_private_hash *futex_phash;
 #endif
 	struct work_struct async_put_work;
 };
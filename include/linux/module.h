@@ -121,6 +121,14 @@ extern void cleanup_module(void);
 #define late_initcall(fn)		module_init(fn)
 #define late_initcall_sync(fn)		module_init(fn)
 
+#define core_initcall_async(fn)		module_init(fn)
+#define postcore_initcall_async(fn)	module_init(fn)
+#define arch_initcall_async(fn)		module_init(fn)
+#define subsys_initcall_async(fn)	module_init(fn)
+#define fs_initcall_async(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
+#define late_initcall_async(fn)		module_init(fn)
+
 #define console_initcall(fn)		module_init(fn)
 #define security_initcall(fn)		module_init(fn)
 
@@ -370,6 +378,11 @@ struct module {
 	const s32 *unused_gpl_crcs;
 #endif
 
+#ifdef CONFIG_MODULE_SYMBOL_HASH
+	/* Entries of the exported symbols in the global symbol hash. */
+	struct ksym_table *ksym_table;
+#endif
+
 #ifdef CONFIG_MODULE_SIG
 	/* Signature was verified. */
 	bool sig_ok;
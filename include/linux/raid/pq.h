@@ -66,6 +66,7 @@ extern const char raid6_empty_zero_page[PAGE_SIZE];
 #define MODULE_LICENSE(licence)
 #define MODULE_DESCRIPTION(desc)
 #define subsys_initcall(x)
+#define subsys_initcall_async(x)
 #define module_exit(x)
 #endif /* __KERNEL__ */
 
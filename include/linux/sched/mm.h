@@ -171,4 +171,11 @@ static inline void memalloc_noio_restore(unsigned int flags)
 	current->flags = (current->flags & ~PF_MEMALLOC_NOIO) | flags;
 }
 
+#ifdef CONFIG_MEMBARRIER
+enum {
+	MEMBARRIER_STATE_PRIVATE_EXPEDITED_READY	= (1U << 0),
+	MEMBARRIER_STATE_PRIVATE_EXPEDITED		= (1U << 1),
+};
+#endif
+
 #endif /* _LINUX_SCHED_MM_H */
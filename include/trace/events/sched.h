@@ -564,6 +564,35 @@ TRACE_EVENT(sched_wake_idle_without_ipi,
 
 	TP_printk("cpu=%d", __entry->cpu)
 );
+
+/*
+ * Tracepoint for the CPU picked by select_idle_sibling(), and the number
+ * of CPUs it looked at to find it:
+ */
+TRACE_EVENT(sched_select_idle_sibling,
+
+	TP_PROTO(struct task_struct *p, int target, int cpu, int nr_scanned),
+
+	TP_ARGS(p, target, cpu, nr_scanned),
+
+	TP_STRUCT__entry(
+		__field(	pid_t,	pid		)
+		__field(	int,	target		)
+		__field(	int,	cpu		)
+		__field(	int,	nr_scanned	)
+	),
+
+	TP_fast_assign(
+		__entry->pid		= p->pid;
+		__entry->target		= target;
+		__entry->cpu		= cpu;
+		__entry->nr_scanned	= nr_scanned;
+	),
+
+	TP_printk("pid=%d target=%d cpu=%d nr_scanned=%d",
+		  __entry->pid, __entry->target, __entry->cpu,
+		  __entry->nr_scanned)
+);
 #endif /* _TRACE_SCHED_H */
 
 /* This part must be outside protection */
@@ -135,6 +135,41 @@ DEFINE_EVENT(timer_class, timer_cancel,
 	TP_ARGS(timer)
 );
 
+/**
+ * timer_expire_batch - called after a timer softirq run of a timer base
+ * @cpu:	the cpu the timer base belongs to
+ * @count:	number of timers expired in this run
+ * @max_late:	largest delay between expiry time and expiry, in jiffies
+ * @deferred:	the expiry budget ran out with expired timers left
+ *
+ * The delay includes the wheel granularity of the timers.
+ */
+TRACE_EVENT(timer_expire_batch,
+
+	TP_PROTO(unsigned int cpu, unsigned int count, unsigned long max_late,
+		 bool deferred),
+
+	TP_ARGS(cpu, count, max_late, deferred),
+
+	TP_STRUCT__entry(
+		__field( unsigned int,	cpu		)
+		__field( unsigned int,	count		)
+		__field( unsigned long,	max_late	)
+		__field( bool,		deferred	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= cpu;
+		__entry->count		= count;
+		__entry->max_late	= max_late;
+		__entry->deferred	= deferred;
+	),
+
+	TP_printk("cpu=%u count=%u max_late=%lu [jiffies] deferred=%d",
+		  __entry->cpu, __entry->count, __entry->max_late,
+		  __entry->deferred)
+);
+
 /**
  * hrtimer_init - called when the hrtimer is initialized
  * @hrtimer:	pointer to struct hrtimer
@@ -269,6 +304,39 @@ DEFINE_EVENT(hrtimer_class, hrtimer_cancel,
 	TP_ARGS(hrtimer)
 );
 
+/**
+ * hrtimer_expire_batch - called after the hrtimer queues have been run
+ * @cpu:	the cpu the queues belong to
+ * @count:	number of hrtimers expired in this run
+ * @max_late:	largest delay between hard expiry time and expiry, in ns
+ * @deferred:	the expiry budget ran out with expired hrtimers left
+ */
+TRACE_EVENT(hrtimer_expire_batch,
+
+	TP_PROTO(unsigned int cpu, unsigned int count, s64 max_late,
+		 bool deferred),
+
+	TP_ARGS(cpu, count, max_late, deferred),
+
+	TP_STRUCT__entry(
+		__field( unsigned int,	cpu		)
+		__field( unsigned int,	count		)
+		__field( s64,		max_late	)
+		__field( bool,		deferred	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= cpu;
+		__entry->count		= count;
+		__entry->max_late	= max_late;
+		__entry->deferred	= deferred;
+	),
+
+	TP_printk("cpu=%u count=%u max_late=%lld [ns] deferred=%d",
+		  __entry->cpu, __entry->count,
+		  (long long) __entry->max_late, __entry->deferred)
+);
+
 /**
  * itimer_state - called when itimer is started or canceled
  * @which:	name of the interval timer
@@ -82,6 +82,7 @@ enum bpf_cmd {
 	BPF_PROG_ATTACH,
 	BPF_PROG_DETACH,
 	BPF_PROG_TEST_RUN,
+	BPF_MAP_LOOKUP_AND_DELETE_ELEM,
 };
 
 enum bpf_map_type {
@@ -99,6 +100,8 @@ enum bpf_map_type {
 	BPF_MAP_TYPE_LPM_TRIE,
 	BPF_MAP_TYPE_ARRAY_OF_MAPS,
 	BPF_MAP_TYPE_HASH_OF_MAPS,
+	BPF_MAP_TYPE_QUEUE,
+	BPF_MAP_TYPE_STACK,
 };
 
 enum bpf_prog_type {
@@ -147,6 +150,19 @@ enum bpf_attach_type {
  * across different LRU lists.
  */
 #define BPF_F_NO_COMMON_LRU	(1U << 1)
+/* Start a BPF_MAP_TYPE_[PERCPU_]HASH map with a small bucket array and
+ * grow or shrink it with the number of elements, up to what max_entries
+ * needs. Requires BPF_F_NO_PREALLOC.
+ */
+#define BPF_F_RESIZABLE		(1U << 2)
+
+/* flags for BPF_PROG_TEST_RUN command */
+/* Time every run of the program and report the 50th, 90th and 99th
+ * percentile and the maximum in test.duration_p50 .. test.duration_max,
+ * next to the mean in test.duration. Percentiles are upper bounds of
+ * histogram buckets that are at most 1/16 of their value wide.
+ */
+#define BPF_F_TEST_RUN_PERCENTILES	(1U << 0)
 
 union bpf_attr {
 	struct { /* anonymous struct used by BPF_MAP_CREATE command */
@@ -200,6 +216,15 @@ union bpf_attr {
 		__aligned_u64	data_out;
 		__u32		repeat;
 		__u32		duration;
+		__u32		ctx_size_in;	/* input: len of ctx_in */
+		__u32		flags;
+		__aligned_u64	ctx_in;
+		__aligned_u64	batch_lens;	/* input: __u32 len of each frame */
+		__u32		batch_size;	/* input: nr of frames in data_in */
+		__u32		duration_p50;
+		__u32		duration_p90;
+		__u32		duration_p99;
+		__u32		duration_max;
 	} test;
 } __attribute__((aligned(8)));
 
@@ -482,6 +507,25 @@ union bpf_attr {
  *     Get the owner uid of the socket stored inside sk_buff.
  *     @skb: pointer to skb
  *     Return: uid of the socket owner on success or overflowuid if failed.
+ *
+ * int bpf_map_push_elem(&map, &value, flags)
+ *     Push an element into a BPF_MAP_TYPE_QUEUE or BPF_MAP_TYPE_STACK map.
+ *     @map: pointer to queue or stack map
+ *     @value: pointer to value
+ *     @flags: BPF_EXIST replaces the oldest element if the map is full
+ *     Return: 0 on success or negative error
+ *
+ * int bpf_map_pop_elem(&map, &value)
+ *     Take the first element out of a queue or the last one out of a stack.
+ *     @map: pointer to queue or stack map
+ *     @value: pointer to where the element is stored, zeroed on error
+ *     Return: 0 on success or negative error
+ *
+ * int bpf_map_peek_elem(&map, &value)
+ *     Same as bpf_map_pop_elem(), but leave the element in the map.
+ *     @map: pointer to queue or stack map
+ *     @value: pointer to where the element is stored, zeroed on error
+ *     Return: 0 on success or negative error
  */
 #define __BPF_FUNC_MAPPER(FN)		\
 	FN(unspec),			\
@@ -531,7 +575,10 @@ union bpf_attr {
 	FN(xdp_adjust_head),		\
 	FN(probe_read_str),		\
 	FN(get_socket_cookie),		\
-	FN(get_socket_uid),
+	FN(get_socket_uid),		\
+	FN(map_push_elem),		\
+	FN(map_pop_elem),		\
+	FN(map_peek_elem),
 
 /* integer value in 'imm' field of BPF_CALL instruction selects which helper
  * function eBPF program intends to call
@@ -197,4 +197,19 @@ struct prctl_mm_map {
 # define PR_CAP_AMBIENT_LOWER		3
 # define PR_CAP_AMBIENT_CLEAR_ALL	4
 
+/*
+ * Control the hash table of PROCESS_PRIVATE futexes: a number of buckets
+ * for a table of the process's own, or 0 to keep using the global one.
+ * Only possible while single-threaded and before a table got installed.
+ */
+#define PR_SET_FUTEX_HASH		48
+#define PR_GET_FUTEX_HASH		49
+
+/*
+ * Share the page tables of private anonymous memory with children on fork
+ * and copy them on first fault, instead of copying them in fork.
+ */
+#define PR_SET_LAZY_FORK		50
+#define PR_GET_LAZY_FORK		51
+
 #endif /* _LINUX_PRCTL_H */
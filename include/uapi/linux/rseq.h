@@ -0,0 +1,95 @@
+#ifndef _UAPI_LINUX_RSEQ_H
+#define _UAPI_LINUX_RSEQ_H
+
+/*
+ * linux/rseq.h
+ *
+ * Restartable sequences system call API
+ */
+
+#include <linux/types.h>
+
+enum rseq_cpu_id_state {
+	RSEQ_CPU_ID_UNINITIALIZED		= -1,
+	RSEQ_CPU_ID_REGISTRATION_FAILED		= -2,
+};
+
+enum rseq_flags {
+	RSEQ_FLAG_UNREGISTER = (1 << 0),
+};
+
+enum rseq_cs_flags_bit {
+	RSEQ_CS_FLAG_NO_RESTART_ON_PREEMPT_BIT	= 0,
+	RSEQ_CS_FLAG_NO_RESTART_ON_SIGNAL_BIT	= 1,
+	RSEQ_CS_FLAG_NO_RESTART_ON_MIGRATE_BIT	= 2,
+};
+
+enum rseq_cs_flags {
+	RSEQ_CS_FLAG_NO_RESTART_ON_PREEMPT	=
+		(1U << RSEQ_CS_FLAG_NO_RESTART_ON_PREEMPT_BIT),
+	RSEQ_CS_FLAG_NO_RESTART_ON_SIGNAL	=
+		(1U << RSEQ_CS_FLAG_NO_RESTART_ON_SIGNAL_BIT),
+	RSEQ_CS_FLAG_NO_RESTART_ON_MIGRATE	=
+		(1U << RSEQ_CS_FLAG_NO_RESTART_ON_MIGRATE_BIT),
+};
+
+/*
+ * struct rseq_cs is aligned on 4 * 8 bytes to ensure it is always
+ * contained within a single cache-line. It is usually declared as
+ * link-time constant data.
+ */
+struct rseq_cs {
+	/* Version of this structure. */
+	__u32 version;
+	/* enum rseq_cs_flags */
+	__u32 flags;
+	__u64 start_ip;
+	/* Offset from start_ip. */
+	__u64 post_commit_offset;
+	/*
+	 * Where the kernel moves the instruction pointer when the critical
+	 * section is aborted. The 32 bits before abort_ip must hold the
+	 * signature passed at registration.
+	 */
+	__u64 abort_ip;
+} __attribute__((aligned(4 * sizeof(__u64))));
+
+/*
+ * struct rseq is aligned on 4 * 8 bytes to ensure it is always
+ * contained within a single cache-line.
+ *
+ * A single struct rseq per thread is allowed.
+ */
+struct rseq {
+	/*
+	 * Restartable sequences cpu_id_start field. Updated by the
+	 * kernel before returning to user-space after a preemption,
+	 * migration or signal delivery. Always holds a valid CPU number,
+	 * so that it can be used as a per-CPU data index without a
+	 * registration check.
+	 */
+	__u32 cpu_id_start;
+	/*
+	 * Restartable sequences cpu_id field. Updated like cpu_id_start,
+	 * but RSEQ_CPU_ID_UNINITIALIZED while the area is not registered
+	 * and RSEQ_CPU_ID_REGISTRATION_FAILED if user-space saw the
+	 * registration fail.
+	 */
+	__u32 cpu_id;
+	/*
+	 * Restartable sequences rseq_cs field. Points to the struct
+	 * rseq_cs of the critical section the thread is in, or is 0.
+	 * User-space sets it when entering a critical section, the kernel
+	 * clears it when it finds the instruction pointer outside of it
+	 * or aborts it. Threads of 32-bit processes keep the upper half
+	 * zero.
+	 */
+	__u64 rseq_cs;
+	/*
+	 * enum rseq_cs_flags applying to all critical sections of the
+	 * thread, or-ed with the flags of each struct rseq_cs.
+	 */
+	__u32 flags;
+} __attribute__((aligned(4 * sizeof(__u64))));
+
+#endif /* _UAPI_LINUX_RSEQ_H */
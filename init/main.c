@@ -819,6 +819,15 @@ extern initcall_t __initcall6_start[];
 extern initcall_t __initcall7_start[];
 extern initcall_t __initcall_end[];
 
+extern initcall_t __initcall0s_start[];
+extern initcall_t __initcall1s_start[];
+extern initcall_t __initcall2s_start[];
+extern initcall_t __initcall3s_start[];
+extern initcall_t __initcall4s_start[];
+extern initcall_t __initcall5s_start[];
+extern initcall_t __initcall6s_start[];
+extern initcall_t __initcall7s_start[];
+
 static initcall_t *initcall_levels[] __initdata = {
 	__initcall0_start,
 	__initcall1_start,
@@ -831,6 +840,18 @@ static initcall_t *initcall_levels[] __initdata = {
 	__initcall_end,
 };
 
+/* Where the _sync initcalls of each level start */
+static initcall_t *initcall_sync_levels[] __initdata = {
+	__initcall0s_start,
+	__initcall1s_start,
+	__initcall2s_start,
+	__initcall3s_start,
+	__initcall4s_start,
+	__initcall5s_start,
+	__initcall6s_start,
+	__initcall7s_start,
+};
+
 /* Keep these in sync with initcalls in include/linux/init.h */
 static char *initcall_level_names[] __initdata = {
 	"early",
@@ -843,9 +864,84 @@ static char *initcall_level_names[] __initdata = {
 	"late",
 };
 
+/*
+ * Initcalls registered with the _async variants are scheduled in their own
+ * async domain, which is synchronized before the _sync initcalls of their
+ * level.  With initcall_parallel=0 they run in place instead, which helps
+ * when chasing an ordering problem.
+ */
+static bool initcall_parallel __initdata = true;
+
+static int __init initcall_parallel_setup(char *str)
+{
+	return kstrtobool(str, &initcall_parallel) == 0;
+}
+__setup("initcall_parallel=", initcall_parallel_setup);
+
+static ASYNC_DOMAIN_EXCLUSIVE(initcall_domain);
+
+/*
+ * Boot time accounting for the critical path report: the wall time of each
+ * level, and the initcall which took longest in it.
+ */
+struct initcall_level_stats {
+	s64		wall_ns;
+	initcall_t	slowest;
+	s64		slowest_ns;
+	bool		slowest_async;
+};
+
+static struct initcall_level_stats
+	initcall_stats[ARRAY_SIZE(initcall_sync_levels)] __initdata;
+static int initcall_level_running __initdata;
+static DEFINE_SPINLOCK(initcall_stats_lock);
+
+static void __init initcall_account(initcall_t fn, ktime_t start, bool async)
+{
+	struct initcall_level_stats *stats = &initcall_stats[initcall_level_running];
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock(&initcall_stats_lock);
+	if (ns > stats->slowest_ns) {
+		stats->slowest = fn;
+		stats->slowest_ns = ns;
+		stats->slowest_async = async;
+	}
+	spin_unlock(&initcall_stats_lock);
+}
+
+static void __init do_async_initcall(void *data, async_cookie_t cookie)
+{
+	initcall_t fn = data;
+	ktime_t start = ktime_get();
+
+	do_one_initcall(fn);
+	initcall_account(fn, start, !!cookie);
+}
+
+int __init schedule_async_initcall(initcall_t fn)
+{
+	if (initcall_parallel)
+		async_schedule_domain(do_async_initcall, fn, &initcall_domain);
+	else
+		do_async_initcall(fn, 0);
+	return 0;
+}
+
+static void __init do_initcall_range(initcall_t *fn, initcall_t *end)
+{
+	ktime_t start;
+
+	for (; fn < end; fn++) {
+		start = ktime_get();
+		do_one_initcall(*fn);
+		initcall_account(*fn, start, false);
+	}
+}
+
 static void __init do_initcall_level(int level)
 {
-	initcall_t *fn;
+	ktime_t start = ktime_get();
 
 	strcpy(initcall_command_line, saved_command_line);
 	parse_args(initcall_level_names[level],
@@ -854,8 +950,12 @@ static void __init do_initcall_level(int level)
 		   level, level,
 		   NULL, &repair_env_string);
 
-	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
-		do_one_initcall(*fn);
+	initcall_level_running = level;
+	do_initcall_range(initcall_levels[level], initcall_sync_levels[level]);
+	async_synchronize_full_domain(&initcall_domain);
+	do_initcall_range(initcall_sync_levels[level], initcall_levels[level+1]);
+
+	initcall_stats[level].wall_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 }
 
 static void __init do_initcalls(void)
@@ -866,6 +966,40 @@ static void __init do_initcalls(void)
 		do_initcall_level(level);
 }
 
+/*
+ * Wait for the async work left over from the initcalls, asynchronous driver
+ * probes in the first place, and report where the time went: levels run
+ * one after the other, so the slowest initcall of each level is on the
+ * critical path of the boot.
+ */
+static void __init initcall_report(void)
+{
+	struct initcall_level_stats *stats;
+	ktime_t start = ktime_get();
+	s64 total = 0, async_ns;
+	int level;
+
+	async_synchronize_full();
+	async_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	for (level = 0; level < ARRAY_SIZE(initcall_stats); level++)
+		total += initcall_stats[level].wall_ns;
+
+	pr_info("initcalls took %lld usecs, %lld usecs waiting for async work after\n",
+		total / NSEC_PER_USEC, async_ns / NSEC_PER_USEC);
+
+	for (level = 0; level < ARRAY_SIZE(initcall_stats); level++) {
+		stats = &initcall_stats[level];
+		if (!stats->slowest)
+			continue;
+		pr_info("  %-8s %8lld usecs, slowest %pF %lld usecs%s\n",
+			initcall_level_names[level],
+			stats->wall_ns / NSEC_PER_USEC, stats->slowest,
+			stats->slowest_ns / NSEC_PER_USEC,
+			stats->slowest_async ? " (async)" : "");
+	}
+}
+
 /*
  * Ok, the machine is now initialized. None of the devices
  * have been touched yet, but the CPU subsystem is up and
@@ -958,7 +1092,7 @@ static int __ref kernel_init(void *unused)
 
 	kernel_init_freeable();
 	/* need to finish all async __init code before freeing the memory */
-	async_synchronize_full();
+	initcall_report();
 	free_initmem();
 	mark_readonly();
 	system_state = SYSTEM_RUNNING;
@@ -1030,6 +1164,8 @@ static noinline void __init kernel_init_freeable(void)
 	smp_init();
 	sched_init_smp();
 
+	workqueue_init_topology();
+
 	page_alloc_init_late();
 
 	do_basic_setup();
@@ -11,9 +11,12 @@
  * General Public License for more details.
  */
 #include <linux/bpf.h>
+#include <linux/bitrev.h>
 #include <linux/jhash.h>
 #include <linux/filter.h>
 #include <linux/rculist_nulls.h>
+#include <linux/workqueue.h>
+#include <linux/irq_work.h>
 #include "percpu_freelist.h"
 #include "bpf_lru_list.h"
 #include "map_in_map.h"
@@ -23,9 +26,25 @@ struct bucket {
 	raw_spinlock_t lock;
 };
 
+/* Bucket array of a BPF_F_RESIZABLE map. While the map is being resized,
+ * @future_tbl points to the new array and buckets below @rehash have been
+ * moved over to it.
+ */
+struct bucket_table {
+	u32 n_buckets;
+	u32 rehash;
+	struct bucket_table __rcu *future_tbl;
+	struct bucket buckets[0];
+};
+
+#define HTAB_MIN_BUCKETS	16
+
 struct bpf_htab {
 	struct bpf_map map;
 	struct bucket *buckets;
+	struct bucket_table __rcu *tbl;
+	struct irq_work resize_irq_work;
+	struct work_struct resize_work;
 	void *elems;
 	union {
 		struct pcpu_freelist freelist;
@@ -58,6 +77,8 @@ struct htab_elem {
 };
 
 static bool htab_lru_map_delete_node(void *arg, struct bpf_lru_node *node);
+static void htab_resize_work(struct work_struct *work);
+static void htab_resize_irq_work(struct irq_work *work);
 
 static bool htab_is_lru(const struct bpf_htab *htab)
 {
@@ -76,6 +97,11 @@ static bool htab_is_prealloc(const struct bpf_htab *htab)
 	return !(htab->map.map_flags & BPF_F_NO_PREALLOC);
 }
 
+static bool htab_is_resizable(const struct bpf_htab *htab)
+{
+	return htab->map.map_flags & BPF_F_RESIZABLE;
+}
+
 static inline void htab_elem_set_ptr(struct htab_elem *l, u32 key_size,
 				     void __percpu *pptr)
 {
@@ -219,6 +245,26 @@ static int alloc_extra_elems(struct bpf_htab *htab)
 	return 0;
 }
 
+static struct bucket_table *htab_table_alloc(u32 n_buckets)
+{
+	struct bucket_table *tbl;
+	int i;
+
+	tbl = bpf_map_area_alloc(sizeof(*tbl) +
+				 n_buckets * sizeof(struct bucket));
+	if (!tbl)
+		return NULL;
+
+	tbl->n_buckets = n_buckets;
+
+	for (i = 0; i < n_buckets; i++) {
+		INIT_HLIST_NULLS_HEAD(&tbl->buckets[i].head, i);
+		raw_spin_lock_init(&tbl->buckets[i].lock);
+	}
+
+	return tbl;
+}
+
 /* Called from syscall */
 static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 {
@@ -233,6 +279,8 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 	 */
 	bool percpu_lru = (attr->map_flags & BPF_F_NO_COMMON_LRU);
 	bool prealloc = !(attr->map_flags & BPF_F_NO_PREALLOC);
+	bool resizable = (attr->map_flags & BPF_F_RESIZABLE);
+	struct bucket_table *tbl;
 	struct bpf_htab *htab;
 	int err, i;
 	u64 cost;
@@ -248,7 +296,8 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 		 */
 		return ERR_PTR(-EPERM);
 
-	if (attr->map_flags & ~(BPF_F_NO_PREALLOC | BPF_F_NO_COMMON_LRU))
+	if (attr->map_flags & ~(BPF_F_NO_PREALLOC | BPF_F_NO_COMMON_LRU |
+				BPF_F_RESIZABLE))
 		/* reserved bits should not be used */
 		return ERR_PTR(-EINVAL);
 
@@ -258,6 +307,15 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 	if (lru && !prealloc)
 		return ERR_PTR(-ENOTSUPP);
 
+	if (resizable && (prealloc ||
+			  (attr->map_type != BPF_MAP_TYPE_HASH &&
+			   attr->map_type != BPF_MAP_TYPE_PERCPU_HASH)))
+		/* preallocated elements would defeat the purpose, and
+		 * lru and fd maps walk their buckets without following
+		 * a resize.
+		 */
+		return ERR_PTR(-EINVAL);
+
 	htab = kzalloc(sizeof(*htab), GFP_USER);
 	if (!htab)
 		return ERR_PTR(-ENOMEM);
@@ -345,6 +403,20 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 		goto free_htab;
 
 	err = -ENOMEM;
+	if (resizable) {
+		/* n_buckets is the upper bound, start out small */
+		tbl = htab_table_alloc(min_t(u32, htab->n_buckets,
+					     HTAB_MIN_BUCKETS));
+		if (!tbl)
+			goto free_htab;
+
+		RCU_INIT_POINTER(htab->tbl, tbl);
+		init_irq_work(&htab->resize_irq_work, htab_resize_irq_work);
+		INIT_WORK(&htab->resize_work, htab_resize_work);
+
+		return &htab->map;
+	}
+
 	htab->buckets = bpf_map_area_alloc(htab->n_buckets *
 					   sizeof(struct bucket));
 	if (!htab->buckets)
@@ -432,6 +504,163 @@ static struct htab_elem *lookup_nulls_elem_raw(struct hlist_nulls_head *head,
 	return NULL;
 }
 
+/* Resizable maps move elements from the old bucket array into the new one
+ * bucket by bucket, always taking the tail of the old chain and linking it
+ * into its new bucket before unlinking it from the old one. Searching the
+ * old array first and the new one second hence cannot miss an element.
+ */
+static struct htab_elem *lookup_resizable_elem_raw(struct bpf_htab *htab,
+						   u32 hash, void *key,
+						   u32 key_size)
+{
+	struct bucket_table *tbl = rcu_dereference(htab->tbl);
+	struct htab_elem *l;
+
+	do {
+		l = lookup_nulls_elem_raw(&tbl->buckets[hash &
+					  (tbl->n_buckets - 1)].head,
+					  hash, key, key_size, tbl->n_buckets);
+		if (l)
+			return l;
+
+		/* pairs with smp_wmb() in htab_rehash_bucket() */
+		smp_rmb();
+		tbl = rcu_dereference(tbl->future_tbl);
+	} while (tbl);
+
+	return NULL;
+}
+
+/* Lock the bucket that elements with @hash currently live in */
+static struct bucket *htab_lock_bucket(struct bpf_htab *htab, u32 hash,
+				       unsigned long *pflags)
+{
+	struct bucket_table *tbl;
+	unsigned long flags;
+	struct bucket *b;
+	u32 idx;
+
+	if (!htab_is_resizable(htab)) {
+		b = __select_bucket(htab, hash);
+		raw_spin_lock_irqsave(&b->lock, flags);
+		*pflags = flags;
+		return b;
+	}
+
+	/* Once a bucket is rehashed, updates for it go to the new array */
+	for (tbl = rcu_dereference(htab->tbl);;
+	     tbl = rcu_dereference(tbl->future_tbl)) {
+		idx = hash & (tbl->n_buckets - 1);
+		b = &tbl->buckets[idx];
+
+		raw_spin_lock_irqsave(&b->lock, flags);
+		if (idx >= READ_ONCE(tbl->rehash))
+			break;
+		raw_spin_unlock_irqrestore(&b->lock, flags);
+	}
+
+	*pflags = flags;
+	return b;
+}
+
+/* Move bucket @idx of @old_tbl over to @new_tbl */
+static void htab_rehash_bucket(struct bucket_table *old_tbl,
+			       struct bucket_table *new_tbl, u32 idx)
+{
+	struct bucket *b = &old_tbl->buckets[idx], *new_b;
+	struct hlist_nulls_node **pprev, *n;
+	unsigned long flags;
+	struct htab_elem *l;
+
+	raw_spin_lock_irqsave(&b->lock, flags);
+
+	while (!hlist_nulls_empty(&b->head)) {
+		pprev = &b->head.first;
+		for (n = *pprev; !is_a_nulls(n->next); n = *pprev)
+			pprev = &n->next;
+
+		l = container_of(n, struct htab_elem, hash_node);
+		new_b = &new_tbl->buckets[l->hash & (new_tbl->n_buckets - 1)];
+
+		raw_spin_lock_nested(&new_b->lock, SINGLE_DEPTH_NESTING);
+		hlist_nulls_add_head_rcu(&l->hash_node, &new_b->head);
+		/* publish in the new bucket before unlinking from the old */
+		smp_wmb();
+		WRITE_ONCE(*pprev, (struct hlist_nulls_node *)NULLS_MARKER(idx));
+		raw_spin_unlock(&new_b->lock);
+	}
+
+	WRITE_ONCE(old_tbl->rehash, idx + 1);
+
+	raw_spin_unlock_irqrestore(&b->lock, flags);
+}
+
+/* Pick a bucket count for a load factor of 37.5% - 75% */
+static u32 htab_resize_target(struct bpf_htab *htab)
+{
+	u64 count = atomic_read(&htab->count);
+
+	return clamp_t(u64, roundup_pow_of_two(count * 4 / 3 + 1),
+		       min_t(u32, htab->n_buckets, HTAB_MIN_BUCKETS),
+		       htab->n_buckets);
+}
+
+static void htab_resize_work(struct work_struct *work)
+{
+	struct bpf_htab *htab = container_of(work, struct bpf_htab,
+					     resize_work);
+	struct bucket_table *old_tbl, *new_tbl;
+	u32 n_buckets, i;
+
+	/* this work is the only one replacing htab->tbl */
+	old_tbl = rcu_dereference_protected(htab->tbl, 1);
+
+	n_buckets = htab_resize_target(htab);
+	if (n_buckets == old_tbl->n_buckets)
+		return;
+
+	new_tbl = htab_table_alloc(n_buckets);
+	if (!new_tbl)
+		return;
+
+	rcu_assign_pointer(old_tbl->future_tbl, new_tbl);
+
+	for (i = 0; i < old_tbl->n_buckets; i++) {
+		htab_rehash_bucket(old_tbl, new_tbl, i);
+		cond_resched();
+	}
+
+	rcu_assign_pointer(htab->tbl, new_tbl);
+
+	/* wait for lookups and updates still walking the old array */
+	synchronize_rcu();
+	bpf_map_area_free(old_tbl);
+}
+
+static void htab_resize_irq_work(struct irq_work *work)
+{
+	struct bpf_htab *htab = container_of(work, struct bpf_htab,
+					     resize_irq_work);
+
+	schedule_work(&htab->resize_work);
+}
+
+/* Kick a resize if the load factor left the 30% - 75% range. Updates can
+ * come from programs running in NMI context or inside the workqueue code,
+ * so the work is queued from an irq_work.
+ */
+static void htab_resize_check(struct bpf_htab *htab)
+{
+	struct bucket_table *tbl = rcu_dereference(htab->tbl);
+	u32 count = atomic_read(&htab->count);
+
+	if ((count > tbl->n_buckets / 4 * 3 &&
+	     tbl->n_buckets < htab->n_buckets) ||
+	    (count < tbl->n_buckets / 10 * 3 &&
+	     tbl->n_buckets > HTAB_MIN_BUCKETS))
+		irq_work_queue(&htab->resize_irq_work);
+}
+
 /* Called from syscall or from eBPF program directly, so
  * arguments have to match bpf_map_lookup_elem() exactly.
  * The return value is adjusted by BPF instructions
@@ -451,6 +680,9 @@ static void *__htab_map_lookup_elem(struct bpf_map *map, void *key)
 
 	hash = htab_map_hash(key, key_size);
 
+	if (htab_is_resizable(htab))
+		return lookup_resizable_elem_raw(htab, hash, key, key_size);
+
 	head = select_bucket(htab, hash);
 
 	l = lookup_nulls_elem_raw(head, hash, key, key_size, htab->n_buckets);
@@ -533,6 +765,89 @@ static bool htab_lru_map_delete_node(void *arg, struct bpf_lru_node *node)
 	return l == tgt_l;
 }
 
+/* Order elements of resizable maps by their bit-reversed hash and then by
+ * key. Bucket j of a 2^b sized array holds the elements whose reversed hash
+ * starts with the reversed b bits of j, so walking buckets in reversed index
+ * order visits elements in the same order whatever size the array has.
+ */
+static int htab_elem_cmp(const struct htab_elem *l, u32 rhash,
+			 const void *key, u32 key_size)
+{
+	u32 l_rhash = bitrev32(l->hash);
+
+	if (l_rhash != rhash)
+		return l_rhash < rhash ? -1 : 1;
+
+	return memcmp(l->key, key, key_size);
+}
+
+static u32 htab_bucket_rev(u32 idx, u32 n_buckets)
+{
+	return n_buckets > 1 ? bitrev32(idx) >> (32 - ilog2(n_buckets)) : 0;
+}
+
+/* Iterating in the order above keeps get_next_key() from skipping or
+ * repeating elements that are moved while the map is being resized.
+ */
+static int htab_resizable_get_next_key(struct bpf_htab *htab, void *key,
+				       void *next_key)
+{
+	struct htab_elem *l, *next_l = NULL, *cand;
+	u32 key_size = htab->map.key_size;
+	struct bucket_table *tbl;
+	struct hlist_nulls_node *n;
+	u32 i, idx, rhash = 0;
+
+	if (key && !lookup_resizable_elem_raw(htab, htab_map_hash(key, key_size),
+					      key, key_size))
+		/* restart from the first element like other hash maps do */
+		key = NULL;
+
+	if (key)
+		rhash = bitrev32(htab_map_hash(key, key_size));
+
+	for (tbl = rcu_dereference(htab->tbl); tbl;
+	     tbl = rcu_dereference(tbl->future_tbl)) {
+		cand = NULL;
+		i = 0;
+		if (key && tbl->n_buckets > 1)
+			i = rhash >> (32 - ilog2(tbl->n_buckets));
+
+		for (; i < tbl->n_buckets && !cand; i++) {
+			idx = htab_bucket_rev(i, tbl->n_buckets);
+
+			hlist_nulls_for_each_entry_rcu(l, n,
+						       &tbl->buckets[idx].head,
+						       hash_node) {
+				/* skip chains entered through moved elements */
+				if ((l->hash & (tbl->n_buckets - 1)) != idx)
+					continue;
+				if (key &&
+				    htab_elem_cmp(l, rhash, key, key_size) <= 0)
+					continue;
+				if (!cand ||
+				    htab_elem_cmp(l, bitrev32(cand->hash),
+						  cand->key, key_size) < 0)
+					cand = l;
+			}
+		}
+
+		if (cand && (!next_l ||
+			     htab_elem_cmp(cand, bitrev32(next_l->hash),
+					   next_l->key, key_size) < 0))
+			next_l = cand;
+
+		/* pairs with smp_wmb() in htab_rehash_bucket() */
+		smp_rmb();
+	}
+
+	if (!next_l)
+		return -ENOENT;
+
+	memcpy(next_key, next_l->key, key_size);
+	return 0;
+}
+
 /* Called from syscall */
 static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 {
@@ -544,6 +859,9 @@ static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 
 	WARN_ON_ONCE(!rcu_read_lock_held());
 
+	if (htab_is_resizable(htab))
+		return htab_resizable_get_next_key(htab, key, next_key);
+
 	key_size = map->key_size;
 
 	if (!key)
@@ -759,11 +1077,9 @@ static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 
 	hash = htab_map_hash(key, key_size);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
 	/* bpf_map_update_elem() can be called in_irq() */
-	raw_spin_lock_irqsave(&b->lock, flags);
+	b = htab_lock_bucket(htab, hash, &flags);
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
 
@@ -791,6 +1107,8 @@ static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 	ret = 0;
 err:
 	raw_spin_unlock_irqrestore(&b->lock, flags);
+	if (!ret && !l_old && htab_is_resizable(htab))
+		htab_resize_check(htab);
 	return ret;
 }
 
@@ -880,11 +1198,9 @@ static int __htab_percpu_map_update_elem(struct bpf_map *map, void *key,
 
 	hash = htab_map_hash(key, key_size);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
 	/* bpf_map_update_elem() can be called in_irq() */
-	raw_spin_lock_irqsave(&b->lock, flags);
+	b = htab_lock_bucket(htab, hash, &flags);
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
 
@@ -908,6 +1224,8 @@ static int __htab_percpu_map_update_elem(struct bpf_map *map, void *key,
 	ret = 0;
 err:
 	raw_spin_unlock_irqrestore(&b->lock, flags);
+	if (!ret && !l_old && htab_is_resizable(htab))
+		htab_resize_check(htab);
 	return ret;
 }
 
@@ -1005,11 +1323,9 @@ static int htab_map_delete_elem(struct bpf_map *map, void *key)
 	key_size = map->key_size;
 
 	hash = htab_map_hash(key, key_size);
-	b = __select_bucket(htab, hash);
+	b = htab_lock_bucket(htab, hash, &flags);
 	head = &b->head;
 
-	raw_spin_lock_irqsave(&b->lock, flags);
-
 	l = lookup_elem_raw(head, hash, key, key_size);
 
 	if (l) {
@@ -1019,6 +1335,8 @@ static int htab_map_delete_elem(struct bpf_map *map, void *key)
 	}
 
 	raw_spin_unlock_irqrestore(&b->lock, flags);
+	if (!ret && htab_is_resizable(htab))
+		htab_resize_check(htab);
 	return ret;
 }
 
@@ -1057,10 +1375,13 @@ static int htab_lru_map_delete_elem(struct bpf_map *map, void *key)
 
 static void delete_all_elements(struct bpf_htab *htab)
 {
+	struct bucket_table *tbl = rcu_dereference_raw(htab->tbl);
+	u32 n_buckets = tbl ? tbl->n_buckets : htab->n_buckets;
 	int i;
 
-	for (i = 0; i < htab->n_buckets; i++) {
-		struct hlist_nulls_head *head = select_bucket(htab, i);
+	for (i = 0; i < n_buckets; i++) {
+		struct hlist_nulls_head *head = tbl ? &tbl->buckets[i].head :
+						      select_bucket(htab, i);
 		struct hlist_nulls_node *n;
 		struct htab_elem *l;
 
@@ -1087,6 +1408,13 @@ static void htab_map_free(struct bpf_map *map)
 	 * not have executed. Wait for them.
 	 */
 	rcu_barrier();
+
+	/* let an in-flight resize finish, it leaves a single bucket array */
+	if (htab_is_resizable(htab)) {
+		irq_work_sync(&htab->resize_irq_work);
+		cancel_work_sync(&htab->resize_work);
+	}
+
 	if (!htab_is_prealloc(htab))
 		delete_all_elements(htab);
 	else
@@ -1094,6 +1422,7 @@ static void htab_map_free(struct bpf_map *map)
 
 	free_percpu(htab->extra_elems);
 	bpf_map_area_free(htab->buckets);
+	bpf_map_area_free(rcu_dereference_raw(htab->tbl));
 	kfree(htab);
 }
 
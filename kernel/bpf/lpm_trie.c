@@ -19,6 +19,10 @@
 /* Intermediate node */
 #define LPM_TREE_NODE_FLAG_IM BIT(0)
 
+/* Bounds for the number of leading key bits resolved by the stride table */
+#define LPM_STRIDE_BITS_MIN	4
+#define LPM_STRIDE_BITS_MAX	16
+
 struct lpm_trie_node;
 
 struct lpm_trie_node {
@@ -29,9 +33,16 @@ struct lpm_trie_node {
 	u8				data[0];
 };
 
+struct lpm_trie_stride {
+	struct lpm_trie_node __rcu	*match;
+	struct lpm_trie_node __rcu	*next;
+};
+
 struct lpm_trie {
 	struct bpf_map			map;
 	struct lpm_trie_node __rcu	*root;
+	struct lpm_trie_stride		*stride;
+	u32				stride_bits;
 	size_t				n_entries;
 	size_t				max_prefixlen;
 	size_t				data_size;
@@ -147,6 +158,27 @@ struct lpm_trie {
  * is a child that can be used to become more specific, the trie is traversed
  * downwards. The last node in the traversal that is a non-intermediate one is
  * returned.
+ *
+ * Walking the upper part of the trie one bit at a time is what dominates the
+ * lookup cost for large maps, so the first @stride_bits bits of the key are
+ * level-compressed into a directly indexed stride table. Every one of the
+ * 2^@stride_bits slots caches the result of walking the trie with those bits:
+ *
+ *  - @match is the longest non-intermediate node with a prefix shorter than
+ *    @stride_bits that matches the slot, or %NULL.
+ *  - @next is the first node on the slot's path whose prefix is at least
+ *    @stride_bits long and matches the slot, or %NULL if there is none.
+ *
+ * A lookup with a key of at least @stride_bits bits hence starts with @match
+ * as its candidate and resumes the binary walk at @next, skipping the top of
+ * the trie entirely. The table is sized after max_entries (fib_trie style
+ * fill factor of roughly one slot per entry) and is not used for maps too
+ * small to benefit from it.
+ *
+ * Updates refresh all slots covered by the updated prefix under @lock. A
+ * single update never changes both pointers of the same slot, and the nodes
+ * they point to are only ever released through RCU, so lockless readers see
+ * either the old or the new state of each slot.
  */
 
 static inline int extract_bit(const u8 *data, size_t index)
@@ -185,6 +217,17 @@ static size_t longest_prefix_match(const struct lpm_trie *trie,
 	return prefixlen;
 }
 
+/* Index of the stride table slot the leading bits of @data fall into */
+static inline u32 stride_index(const struct lpm_trie *trie, const u8 *data)
+{
+	u32 index = data[0] << 8;
+
+	if (trie->data_size > 1)
+		index |= data[1];
+
+	return index >> (16 - trie->stride_bits);
+}
+
 /* Called from syscall or from eBPF program */
 static void *trie_lookup_elem(struct bpf_map *map, void *_key)
 {
@@ -192,9 +235,21 @@ static void *trie_lookup_elem(struct bpf_map *map, void *_key)
 	struct lpm_trie_node *node, *found = NULL;
 	struct bpf_lpm_trie_key *key = _key;
 
-	/* Start walking the trie from the root node ... */
+	/* Start walking the trie from the stride table slot of the key if
+	 * it is long enough to be indexed by it, or from the root node ...
+	 */
+
+	if (trie->stride && key->prefixlen >= trie->stride_bits) {
+		struct lpm_trie_stride *slot;
 
-	for (node = rcu_dereference(trie->root); node;) {
+		slot = &trie->stride[stride_index(trie, key->data)];
+		found = rcu_dereference(slot->match);
+		node = rcu_dereference(slot->next);
+	} else {
+		node = rcu_dereference(trie->root);
+	}
+
+	while (node) {
 		unsigned int next_bit;
 		size_t matchlen;
 
@@ -257,6 +312,109 @@ static struct lpm_trie_node *lpm_trie_node_alloc(const struct lpm_trie *trie,
 	return node;
 }
 
+/* Point the stride table slots [@start, @end) at @match and @next */
+static void stride_set(struct lpm_trie *trie, u32 start, u32 end,
+		       struct lpm_trie_node *match, struct lpm_trie_node *next)
+{
+	u32 i;
+
+	for (i = start; i < end; i++) {
+		rcu_assign_pointer(trie->stride[i].match, match);
+		rcu_assign_pointer(trie->stride[i].next, next);
+	}
+}
+
+/**
+ * stride_fill() - refresh a range of stride table slots
+ * @trie:	The trie to operate on
+ * @node:	The node all slots in the range have reached in their walk
+ * @match:	The candidate all slots in the range have collected so far
+ * @index:	The first slot of the range
+ * @bits:	The number of leading bits shared by all slots in the range
+ *
+ * Walk the trie below @node for the 2^(@stride_bits - @bits) slots starting
+ * at @index and store the resulting match and resume node in each of them.
+ * Every node is visited at most once. Must be called with @trie->lock held.
+ */
+static void stride_fill(struct lpm_trie *trie, struct lpm_trie_node *node,
+			struct lpm_trie_node *match, u32 index, u32 bits)
+{
+	u32 s = trie->stride_bits, prefixlen, node_index, end;
+	unsigned int next_bit;
+
+	while (node) {
+		prefixlen = min_t(u32, node->prefixlen, s);
+		node_index = stride_index(trie, node->data);
+		node_index &= ~((1U << (s - prefixlen)) - 1);
+
+		if (prefixlen > bits) {
+			/* @node only covers part of the range. The walk ends
+			 * here for the slots outside of its prefix, so narrow
+			 * the range down to the ones inside.
+			 */
+			if ((node_index ^ index) >> (s - bits)) {
+				node = NULL;
+				break;
+			}
+
+			end = index + (1U << (s - bits));
+			stride_set(trie, index, node_index, match, NULL);
+			stride_set(trie, node_index + (1U << (s - prefixlen)),
+				   end, match, NULL);
+
+			index = node_index;
+			bits = prefixlen;
+		} else if ((node_index ^ index) >> (s - prefixlen)) {
+			node = NULL;
+			break;
+		}
+
+		if (node->prefixlen >= s)
+			break;
+
+		if (!(node->flags & LPM_TREE_NODE_FLAG_IM))
+			match = node;
+
+		if (node->prefixlen == bits) {
+			/* The next bit differs within the range, so split it
+			 * in halves and handle the lower one recursively.
+			 */
+			bits++;
+			stride_fill(trie,
+				    rcu_dereference_protected(node->child[0],
+					lockdep_is_held(&trie->lock)),
+				    match, index, bits);
+			index |= 1U << (s - bits);
+			next_bit = 1;
+		} else {
+			next_bit = (index >> (s - 1 - node->prefixlen)) & 1;
+		}
+
+		node = rcu_dereference_protected(node->child[next_bit],
+					lockdep_is_held(&trie->lock));
+	}
+
+	stride_set(trie, index, index + (1U << (s - bits)), match, node);
+}
+
+/* Refresh all stride table slots covered by the prefix of @key */
+static void stride_update(struct lpm_trie *trie,
+			  const struct bpf_lpm_trie_key *key)
+{
+	u32 bits, index;
+
+	if (!trie->stride)
+		return;
+
+	bits = min_t(u32, key->prefixlen, trie->stride_bits);
+	index = stride_index(trie, key->data);
+	index &= ~((1U << (trie->stride_bits - bits)) - 1);
+
+	stride_fill(trie, rcu_dereference_protected(trie->root,
+				lockdep_is_held(&trie->lock)),
+		    NULL, index, bits);
+}
+
 /* Called from syscall or from eBPF program */
 static int trie_update_elem(struct bpf_map *map,
 			    void *_key, void *value, u64 flags)
@@ -381,6 +539,8 @@ static int trie_update_elem(struct bpf_map *map,
 
 		kfree(new_node);
 		kfree(im_node);
+	} else {
+		stride_update(trie, key);
 	}
 
 	raw_spin_unlock_irqrestore(&trie->lock, irq_flags);
@@ -436,9 +596,19 @@ static struct bpf_map *trie_alloc(union bpf_attr *attr)
 			  offsetof(struct bpf_lpm_trie_key, data);
 	trie->max_prefixlen = trie->data_size * 8;
 
+	/* Size the stride table to about one slot per entry */
+	trie->stride_bits = min_t(u32, fls(attr->max_entries - 1),
+				  LPM_STRIDE_BITS_MAX);
+	trie->stride_bits = min_t(u32, trie->stride_bits,
+				  trie->max_prefixlen);
+	if (trie->stride_bits < LPM_STRIDE_BITS_MIN)
+		trie->stride_bits = 0;
+
 	cost_per_node = sizeof(struct lpm_trie_node) +
 			attr->value_size + trie->data_size;
 	cost += (u64) attr->max_entries * cost_per_node;
+	if (trie->stride_bits)
+		cost += sizeof(struct lpm_trie_stride) << trie->stride_bits;
 	if (cost >= U32_MAX - PAGE_SIZE) {
 		ret = -E2BIG;
 		goto out_err;
@@ -450,6 +620,15 @@ static struct bpf_map *trie_alloc(union bpf_attr *attr)
 	if (ret)
 		goto out_err;
 
+	if (trie->stride_bits) {
+		trie->stride = bpf_map_area_alloc(sizeof(struct lpm_trie_stride)
+						  << trie->stride_bits);
+		if (!trie->stride) {
+			ret = -ENOMEM;
+			goto out_err;
+		}
+	}
+
 	raw_spin_lock_init(&trie->lock);
 
 	return &trie->map;
@@ -498,6 +677,8 @@ static void trie_free(struct bpf_map *map)
 
 unlock:
 	raw_spin_unlock(&trie->lock);
+
+	bpf_map_area_free(trie->stride);
 }
 
 static int trie_get_next_key(struct bpf_map *map, void *key, void *next_key)
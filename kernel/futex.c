@@ -45,6 +45,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include <linux/poll.h>
 #include <linux/fs.h>
 #include <linux/file.h>
@@ -63,6 +64,7 @@
 #include <linux/sched/rt.h>
 #include <linux/sched/wake_q.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/coredump.h>
 #include <linux/hugetlb.h>
 #include <linux/freezer.h>
 #include <linux/bootmem.h>
@@ -277,6 +279,25 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+/*
+ * PROCESS_PRIVATE futexes of a multi-threaded process hash into a table
+ * of its own, allocated on the node of the process, so that unrelated
+ * processes do not contend on the same bucket locks and cache lines.
+ *
+ * A private key has to hash into the same table for the lifetime of the
+ * mm, otherwise a waker could miss a waiter queued before a switch. The
+ * table is therefore only installed while current is the only user of
+ * the mm, and it stays until the mm is freed.
+ */
+struct futex_private_hash {
+	unsigned int hashmask;
+	struct futex_hash_bucket queues[0];
+};
+
+#define FUTEX_PRIVATE_HASH_MIN		16
+#define FUTEX_PRIVATE_HASH_DEFAULT_MAX	256
+#define FUTEX_PRIVATE_HASH_MAX		8192
+
 
 /*
  * Fault injections for futexes.
@@ -384,20 +405,128 @@ static inline int hb_waiters_pending(struct futex_hash_bucket *hb)
 }
 
 /**
- * hash_futex - Return the hash bucket in the global hash
+ * hash_futex - Return the hash bucket for a futex key
  * @key:	Pointer to the futex key for which the hash is calculated
  *
  * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * corresponding hash bucket in the private hash of the mm for private keys
+ * of processes that have one, and in the global hash otherwise.
  */
 static struct futex_hash_bucket *hash_futex(union futex_key *key)
 {
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
+
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED))) {
+		struct futex_private_hash *ph;
+
+		ph = READ_ONCE(key->private.mm->futex_phash);
+		if (ph)
+			return &ph->queues[hash & ph->hashmask];
+	}
+
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
+static void futex_hash_bucket_init(struct futex_hash_bucket *hb)
+{
+	atomic_set(&hb->waiters, 0);
+	plist_head_init(&hb->chain);
+	spin_lock_init(&hb->lock);
+}
+
+static int futex_private_hash_install(struct mm_struct *mm,
+				      unsigned int slots)
+{
+	struct futex_private_hash *ph;
+	int node = numa_node_id();
+	unsigned int i;
+	size_t size;
+
+	if (mm->futex_phash || atomic_read(&mm->mm_users) != 1)
+		return -EBUSY;
+
+	size = sizeof(*ph) + slots * sizeof(struct futex_hash_bucket);
+	ph = kzalloc_node(size, GFP_KERNEL | __GFP_NOWARN, node);
+	if (!ph)
+		ph = vzalloc_node(size, node);
+	if (!ph)
+		return -ENOMEM;
+
+	ph->hashmask = slots - 1;
+	for (i = 0; i < slots; i++)
+		futex_hash_bucket_init(&ph->queues[i]);
+
+	WRITE_ONCE(mm->futex_phash, ph);
+	return 0;
+}
+
+void futex_mm_init(struct mm_struct *mm)
+{
+	mm->futex_phash = NULL;
+}
+
+void futex_mm_free(struct mm_struct *mm)
+{
+	kvfree(mm->futex_phash);
+}
+
+/*
+ * Called from clone() before a new thread takes its reference on the mm,
+ * which is the last point at which current is sure to be the only task
+ * queued on the private futexes of the mm. Size the table for the CPUs
+ * the threads can run on; processes expecting many more contended
+ * futexes pick a bigger one with PR_SET_FUTEX_HASH before creating
+ * threads.
+ */
+void futex_mm_clone_thread(struct mm_struct *mm)
+{
+	unsigned int slots;
+
+	if (mm->futex_phash || test_bit(MMF_FUTEX_GLOBAL_HASH, &mm->flags))
+		return;
+
+	slots = roundup_pow_of_two(4 * num_online_cpus());
+	slots = clamp_t(unsigned int, slots, FUTEX_PRIVATE_HASH_MIN,
+			FUTEX_PRIVATE_HASH_DEFAULT_MAX);
+
+	/* on failure private futexes simply stay in the global hash */
+	futex_private_hash_install(mm, slots);
+}
+
+/*
+ * PR_SET_FUTEX_HASH: use a private hash of @slots buckets, rounded up to a
+ * power of two, or keep private futexes in the global hash for @slots == 0.
+ * Only possible before the process got a private hash, and while it is
+ * single-threaded.
+ */
+int futex_hash_prctl_set(unsigned long slots)
+{
+	struct mm_struct *mm = current->mm;
+
+	if (slots > FUTEX_PRIVATE_HASH_MAX)
+		return -EINVAL;
+	if (mm->futex_phash)
+		return -EBUSY;
+
+	if (!slots) {
+		set_bit(MMF_FUTEX_GLOBAL_HASH, &mm->flags);
+		return 0;
+	}
+
+	slots = max_t(unsigned long, roundup_pow_of_two(slots),
+		      FUTEX_PRIVATE_HASH_MIN);
+	return futex_private_hash_install(mm, slots);
+}
+
+int futex_hash_prctl_get(void)
+{
+	struct futex_private_hash *ph = READ_ONCE(current->mm->futex_phash);
+
+	return ph ? ph->hashmask + 1 : 0;
+}
+
 
 /**
  * match_futex - Check whether two futex keys are equal
@@ -2574,6 +2703,195 @@ static long futex_wait_restart(struct restart_block *restart)
 				restart->futex.val, tp, restart->futex.bitset);
 }
 
+/**
+ * unqueue_multiple() - Remove several futex_qs from their hash buckets
+ * @qs:		the futex_qs to unqueue
+ * @count:	number of futex_qs in @qs
+ *
+ * Every entry must have been queued with queue_me() before.
+ *
+ * Return: index of the first futex_q that had already been woken, or -1
+ */
+static int unqueue_multiple(struct futex_q *qs, int count)
+{
+	int ret = -1;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!unqueue_me(&qs[i]) && ret < 0)
+			ret = i;
+	}
+	return ret;
+}
+
+/**
+ * futex_wait_multiple_setup() - Prepare to wait on and queue several futexes
+ * @wb:		the futex_wait_block entries copied from userspace
+ * @qs:		the associated futex_qs
+ * @count:	number of entries in @wb and @qs
+ * @flags:	futex flags (FLAGS_SHARED, etc.)
+ * @woken:	index of an entry woken while the others were being queued
+ *
+ * This is futex_wait_setup() for a list of futexes. The task state is set
+ * before the first futex_q is queued, so a wakeup of one of the already
+ * queued entries while the value of a later one is checked is not lost.
+ *
+ * Return:
+ *  0 - all futexes contained their expected value and are queued;
+ *  1 - one futex was already woken, its index is in @woken, none is queued;
+ * <0 - -EFAULT or -EWOULDBLOCK, and none is queued
+ */
+static int futex_wait_multiple_setup(struct futex_wait_block *wb,
+				     struct futex_q *qs, int count,
+				     unsigned int flags, int *woken)
+{
+	struct futex_hash_bucket *hb;
+	u32 __user *uaddr;
+	int ret, i, j;
+	u32 uval;
+
+retry:
+	for (i = 0; i < count; i++) {
+		uaddr = u64_to_user_ptr(wb[i].uaddr);
+		ret = get_futex_key(uaddr, flags & FLAGS_SHARED, &qs[i].key,
+				    VERIFY_READ);
+		if (unlikely(ret)) {
+			while (--i >= 0)
+				put_futex_key(&qs[i].key);
+			return ret;
+		}
+	}
+
+	set_current_state(TASK_INTERRUPTIBLE);
+
+	for (i = 0; i < count; i++) {
+		uaddr = u64_to_user_ptr(wb[i].uaddr);
+
+		hb = queue_lock(&qs[i]);
+		ret = get_futex_value_locked(&uval, uaddr);
+		if (!ret && uval == wb[i].val) {
+			queue_me(&qs[i], hb);
+			continue;
+		}
+
+		queue_unlock(hb);
+		__set_current_state(TASK_RUNNING);
+
+		/* unqueue_me() drops the key refs of the queued entries */
+		*woken = unqueue_multiple(qs, i);
+		for (j = i; j < count; j++)
+			put_futex_key(&qs[j].key);
+
+		if (*woken >= 0)
+			return 1;
+		if (!ret)
+			return -EWOULDBLOCK;
+
+		ret = get_user(uval, uaddr);
+		if (ret)
+			return ret;
+		goto retry;
+	}
+
+	return 0;
+}
+
+static int futex_wait_multiple(u32 __user *uaddr, unsigned int flags,
+			       u32 count, ktime_t *abs_time)
+{
+	struct hrtimer_sleeper timeout, *to = NULL;
+	struct futex_wait_block *wb;
+	struct futex_q *qs;
+	int ret, i, woken;
+
+	if (!count || count > FUTEX_MULTIPLE_MAX_COUNT)
+		return -EINVAL;
+
+	wb = memdup_user(uaddr, count * sizeof(*wb));
+	if (IS_ERR(wb))
+		return PTR_ERR(wb);
+
+	qs = kmalloc_array(count, sizeof(*qs), GFP_KERNEL);
+	if (!qs) {
+		ret = -ENOMEM;
+		goto out_free_wb;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!wb[i].bitset) {
+			ret = -EINVAL;
+			goto out_free;
+		}
+		qs[i] = futex_q_init;
+		qs[i].bitset = wb[i].bitset;
+	}
+
+	if (abs_time) {
+		to = &timeout;
+
+		hrtimer_init_on_stack(&to->timer, (flags & FLAGS_CLOCKRT) ?
+				      CLOCK_REALTIME : CLOCK_MONOTONIC,
+				      HRTIMER_MODE_ABS);
+		hrtimer_init_sleeper(to, current);
+		hrtimer_set_expires_range_ns(&to->timer, *abs_time,
+					     current->timer_slack_ns);
+	}
+
+retry:
+	/* On success all entries are queued and hold a key ref. */
+	ret = futex_wait_multiple_setup(wb, qs, count, flags, &woken);
+	if (ret) {
+		if (ret > 0)
+			ret = woken;
+		goto out;
+	}
+
+	/* Arm the timer */
+	if (to)
+		hrtimer_start_expires(&to->timer, HRTIMER_MODE_ABS);
+
+	/*
+	 * If any entry has been removed from its hash list, another task
+	 * has tried to wake us, and we can skip the call to schedule().
+	 */
+	for (i = 0; i < count; i++) {
+		if (plist_node_empty(&qs[i].list))
+			break;
+	}
+	if (i == count && (!to || to->task))
+		freezable_schedule();
+	__set_current_state(TASK_RUNNING);
+
+	/* If we were woken (and unqueued), return which entry woke us. */
+	ret = unqueue_multiple(qs, count);
+	if (ret >= 0)
+		goto out;
+	ret = -ETIMEDOUT;
+	if (to && !to->task)
+		goto out;
+
+	/*
+	 * We expect signal_pending(current), but we might be the
+	 * victim of a spurious wakeup as well.
+	 */
+	if (!signal_pending(current))
+		goto retry;
+
+	/* The timeout is absolute, so the syscall can simply be restarted. */
+	ret = -ERESTARTSYS;
+
+out:
+	if (to) {
+		hrtimer_cancel(&to->timer);
+		destroy_hrtimer_on_stack(&to->timer);
+	}
+out_free:
+	kfree(qs);
+out_free_wb:
+	kfree(wb);
+	return ret;
+}
+
 
 /*
  * Userspace tried a 0 -> TID atomic transition of the futex value
@@ -3372,7 +3690,7 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	if (op & FUTEX_CLOCK_REALTIME) {
 		flags |= FLAGS_CLOCKRT;
 		if (cmd != FUTEX_WAIT && cmd != FUTEX_WAIT_BITSET && \
-		    cmd != FUTEX_WAIT_REQUEUE_PI)
+		    cmd != FUTEX_WAIT_REQUEUE_PI && cmd != FUTEX_WAIT_MULTIPLE)
 			return -ENOSYS;
 	}
 
@@ -3413,6 +3731,8 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 					     uaddr2);
 	case FUTEX_CMP_REQUEUE_PI:
 		return futex_requeue(uaddr, flags, uaddr2, val, val2, &val3, 1);
+	case FUTEX_WAIT_MULTIPLE:
+		return futex_wait_multiple(uaddr, flags, val, timeout);
 	}
 	return -ENOSYS;
 }
@@ -3429,7 +3749,8 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (unlikely(should_fail_futex(!(op & FUTEX_PRIVATE_FLAG))))
 			return -EFAULT;
 		if (copy_from_user(&ts, utime, sizeof(ts)) != 0)
@@ -3493,11 +3814,8 @@ static int __init futex_init(void)
 
 	futex_detect_cmpxchg();
 
-	for (i = 0; i < futex_hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	for (i = 0; i < futex_hashsize; i++)
+		futex_hash_bucket_init(&futex_queues[i]);
 
 	return 0;
 }
@@ -42,6 +42,15 @@ do {									\
 	smp_store_release((l), 1)
 #endif
 
+#ifndef arch_mcs_pass_lock
+/*
+ * Like arch_mcs_spin_unlock_contended(), but hand over a value other than 1;
+ * the NUMA-aware qspinlock uses it to pass extra state to the next waiter.
+ */
+#define arch_mcs_pass_lock(l, val)					\
+	smp_store_release((l), (val))
+#endif
+
 /*
  * Note: the smp_load_acquire/smp_store_release pair is not
  * sufficient to form a full memory barrier across
@@ -7,6 +7,8 @@
 #include <linux/sched.h>
 #include <linux/errno.h>
 
+#include <trace/events/lock.h>
+
 int __percpu_init_rwsem(struct percpu_rw_semaphore *sem,
 			const char *name, struct lock_class_key *rwsem_key)
 {
@@ -82,9 +84,11 @@ int __percpu_down_read(struct percpu_rw_semaphore *sem, int try)
 	/*
 	 * Avoid lockdep for the down/up_read() we already have them.
 	 */
+	trace_contention_begin(sem, LCB_F_PERCPU | LCB_F_READ);
 	__down_read(&sem->rw_sem);
 	this_cpu_inc(*sem->read_count);
 	__up_read(&sem->rw_sem);
+	trace_contention_end(sem, 0);
 
 	preempt_disable();
 	return 1;
@@ -159,7 +163,11 @@ void percpu_down_write(struct percpu_rw_semaphore *sem)
 	 */
 
 	/* Wait for all now active readers to complete. */
-	rcuwait_wait_event(&sem->writer, readers_active_check(sem));
+	if (!readers_active_check(sem)) {
+		trace_contention_begin(sem, LCB_F_PERCPU | LCB_F_WRITE);
+		rcuwait_wait_event(&sem->writer, readers_active_check(sem));
+		trace_contention_end(sem, 0);
+	}
 }
 EXPORT_SYMBOL_GPL(percpu_down_write);
 
@@ -20,7 +20,7 @@
  *          Peter Zijlstra <peterz@infradead.org>
  */
 
-#ifndef _GEN_PV_LOCK_SLOWPATH
+#if !defined(_GEN_PV_LOCK_SLOWPATH) && !defined(_GEN_CNA_LOCK_SLOWPATH)
 
 #include <linux/smp.h>
 #include <linux/bug.h>
@@ -30,6 +30,7 @@
 #include <linux/mutex.h>
 #include <asm/byteorder.h>
 #include <asm/qspinlock.h>
+#include <trace/events/lock.h>
 
 /*
  * The basic principle of a queue-based spinlock can best be understood
@@ -69,7 +70,7 @@
 
 #include "mcs_spinlock.h"
 
-#ifdef CONFIG_PARAVIRT_SPINLOCKS
+#if defined(CONFIG_PARAVIRT_SPINLOCKS) || defined(CONFIG_NUMA_AWARE_SPINLOCKS)
 #define MAX_NODES	8
 #else
 #define MAX_NODES	4
@@ -81,7 +82,8 @@
  *
  * Exactly fits one 64-byte cacheline on a 64-bit architecture.
  *
- * PV doubles the storage and uses the second cacheline for PV state.
+ * PV and CNA double the storage and use the second cacheline for their
+ * state.
  */
 static DEFINE_PER_CPU_ALIGNED(struct mcs_spinlock, mcs_nodes[MAX_NODES]);
 
@@ -263,6 +265,35 @@ static __always_inline u32  __pv_wait_head_or_lock(struct qspinlock *lock,
 #define pv_kick_node		__pv_kick_node
 #define pv_wait_head_or_lock	__pv_wait_head_or_lock
 
+/*
+ * Try to clear the tail when the queue head is the only waiter; n,0,0 -> 0,0,1.
+ * On failure @val is updated with the current lock value.
+ */
+static __always_inline bool __try_clear_tail(struct qspinlock *lock,
+					     u32 *val,
+					     struct mcs_spinlock *node)
+{
+	u32 old = atomic_cmpxchg_relaxed(&lock->val, *val, _Q_LOCKED_VAL);
+
+	if (old == *val)
+		return true;
+
+	*val = old;
+	return false;
+}
+
+/*
+ * Hand the MCS lock over to our successor in the wait queue.
+ */
+static __always_inline void __mcs_pass_lock(struct mcs_spinlock *node,
+					    struct mcs_spinlock *next)
+{
+	arch_mcs_spin_unlock_contended(&next->locked);
+}
+
+#define try_clear_tail		__try_clear_tail
+#define mcs_pass_lock		__mcs_pass_lock
+
 #ifdef CONFIG_PARAVIRT_SPINLOCKS
 #define queued_spin_lock_slowpath	native_queued_spin_lock_slowpath
 #endif
@@ -384,7 +415,7 @@ void queued_spin_unlock_wait(struct qspinlock *lock)
 EXPORT_SYMBOL(queued_spin_unlock_wait);
 #endif
 
-#endif /* _GEN_PV_LOCK_SLOWPATH */
+#endif /* !_GEN_PV_LOCK_SLOWPATH && !_GEN_CNA_LOCK_SLOWPATH */
 
 /**
  * queued_spin_lock_slowpath - acquire the queued spinlock
@@ -465,6 +496,8 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	if (new == _Q_LOCKED_VAL)
 		return;
 
+	trace_contention_begin(lock, LCB_F_SPIN);
+
 	/*
 	 * we're pending, wait for the owner to go away.
 	 *
@@ -483,6 +516,7 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	 * *,1,0 -> *,0,1
 	 */
 	clear_pending_set_locked(lock);
+	trace_contention_end(lock, 0);
 	return;
 
 	/*
@@ -507,6 +541,8 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	if (queued_spin_trylock(lock))
 		goto release;
 
+	trace_contention_begin(lock, LCB_F_SPIN);
+
 	/*
 	 * We have already touched the queueing cacheline; don't bother with
 	 * pending stuff.
@@ -576,6 +612,8 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	val = smp_cond_load_acquire(&lock->val.counter, !(VAL & _Q_LOCKED_PENDING_MASK));
 
 locked:
+	trace_contention_end(lock, 0);
+
 	/*
 	 * claim the lock:
 	 *
@@ -597,11 +635,8 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 		 * necessary acquire semantics required for locking. At most
 		 * two iterations of this loop may be ran.
 		 */
-		old = atomic_cmpxchg_relaxed(&lock->val, val, _Q_LOCKED_VAL);
-		if (old == val)
+		if (try_clear_tail(lock, &val, node))
 			goto release;	/* No contention */
-
-		val = old;
 	}
 
 	/*
@@ -612,7 +647,7 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 			cpu_relax();
 	}
 
-	arch_mcs_spin_unlock_contended(&next->locked);
+	mcs_pass_lock(node, next);
 	pv_kick_node(lock, next);
 
 release:
@@ -623,6 +658,33 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 }
 EXPORT_SYMBOL(queued_spin_lock_slowpath);
 
+/*
+ * Generate the NUMA-aware (CNA) code for queued_spin_lock_slowpath().
+ */
+#if !defined(_GEN_CNA_LOCK_SLOWPATH) && defined(CONFIG_NUMA_AWARE_SPINLOCKS)
+#define _GEN_CNA_LOCK_SLOWPATH
+
+#undef  pv_init_node
+#define pv_init_node		cna_init_node
+
+#undef  pv_wait_head_or_lock
+#define pv_wait_head_or_lock	cna_wait_head_or_lock
+
+#undef  try_clear_tail
+#define try_clear_tail		cna_try_clear_tail
+
+#undef  mcs_pass_lock
+#define mcs_pass_lock		cna_pass_lock
+
+/* qspinlock_cna.h refers to the pv_lock_ops member by this name */
+#undef  queued_spin_lock_slowpath
+#include "qspinlock_cna.h"
+
+#define queued_spin_lock_slowpath	__cna_queued_spin_lock_slowpath
+#include "qspinlock.c"
+
+#endif
+
 /*
  * Generate the paravirt code for queued_spin_unlock_slowpath().
  */
@@ -637,6 +699,12 @@ EXPORT_SYMBOL(queued_spin_lock_slowpath);
 #undef pv_kick_node
 #undef pv_wait_head_or_lock
 
+#undef  try_clear_tail
+#define try_clear_tail		__try_clear_tail
+
+#undef  mcs_pass_lock
+#define mcs_pass_lock		__mcs_pass_lock
+
 #undef  queued_spin_lock_slowpath
 #define queued_spin_lock_slowpath	__pv_queued_spin_lock_slowpath
 
@@ -0,0 +1,272 @@
+#ifndef _GEN_CNA_LOCK_SLOWPATH
+#error "do not include this file"
+#endif
+
+#include <linux/topology.h>
+#include <linux/sched/clock.h>
+
+/*
+ * Implement a NUMA-aware version of the MCS queue (aka CNA, or compact
+ * NUMA-aware lock).
+ *
+ * Waiters are kept in two queues: the primary (MCS) queue, and a secondary
+ * queue holding waiters that run on a different NUMA node than the current
+ * queue head. Schematically:
+ *
+ *    cna_node
+ *   +----------+     +--------+         +--------+
+ *   |mcs:next  | --> |mcs:next| --> ... |mcs:next| --> NULL  [Primary queue]
+ *   |mcs:locked| -.  +--------+         +--------+
+ *   +----------+  |
+ *                 `----------------------.
+ *                                        v
+ *                 +--------+         +--------+
+ *                 |mcs:next| --> ... |mcs:next|            [Secondary queue]
+ *                 +--------+         +--------+
+ *                     ^                    |
+ *                     `--------------------'
+ *
+ * The secondary queue is a circular list hanging off the MCS lock holder:
+ * mcs:locked is 1 (or 0 for an uncontended queue head) when there is no
+ * secondary queue, and otherwise contains the encoded tail of it; the tail's
+ * next pointer leads to the head of the secondary queue. The MCS lock, and
+ * with it the secondary queue, is handed over with a single store.
+ *
+ * While the queue head waits for the owner to release the lock, it scans the
+ * primary queue for the first waiter running on its own node and moves the
+ * waiters it skipped over to the tail of the secondary queue. The lock thus
+ * tends to stay on one node, and with it the cachelines it protects.
+ *
+ * When the primary queue runs empty, the secondary queue is promoted to be
+ * the primary one. To bound the delay seen by remote waiters, the secondary
+ * queue is also spliced back in front of the primary queue once its oldest
+ * waiter has been parked there for longer than cna_threshold_ns.
+ *
+ * The CNA state lives in the second cacheline of the per-cpu node storage,
+ * the same way the paravirt state does.
+ */
+
+struct cna_node {
+	struct mcs_spinlock	mcs;
+	struct mcs_spinlock	__res[3];
+
+	int			numa_node;
+	u32			encoded_tail;	/* self */
+	u64			start_time;	/* set on the secondary queue head */
+};
+
+/*
+ * Upper bound on how long a waiter can be parked in the secondary queue
+ * before it is moved back into the primary queue.
+ */
+static u64 cna_threshold_ns = NSEC_PER_MSEC;
+
+static inline struct cna_node *to_cna_node(struct mcs_spinlock *node)
+{
+	return (struct cna_node *)node;
+}
+
+/*
+ * Return the encoded tail of the secondary queue held by @node, or 0 if
+ * there is none.
+ */
+static inline u32 cna_secondary_tail(struct mcs_spinlock *node)
+{
+	u32 val = node->locked;
+
+	return val > 1 ? val : 0;
+}
+
+static void cna_init_node(struct mcs_spinlock *node)
+{
+	struct cna_node *cn = to_cna_node(node);
+	int idx = node - this_cpu_ptr(&mcs_nodes[0]);
+
+	BUILD_BUG_ON(sizeof(struct cna_node) > 5*sizeof(struct mcs_spinlock));
+
+	cn->numa_node = numa_node_id();
+	cn->encoded_tail = encode_tail(smp_processor_id(), idx);
+}
+
+/*
+ * Move the waiters @first ... @last, which have all been linked up, to the
+ * tail of the secondary queue of @node.
+ */
+static void cna_splice_tail(struct mcs_spinlock *node,
+			    struct mcs_spinlock *first,
+			    struct mcs_spinlock *last)
+{
+	u32 stail = cna_secondary_tail(node);
+
+	if (!stail) {
+		/* start a new secondary queue */
+		to_cna_node(first)->start_time = local_clock();
+		WRITE_ONCE(last->next, first);
+	} else {
+		struct mcs_spinlock *tail_2nd = decode_tail(stail);
+
+		WRITE_ONCE(last->next, tail_2nd->next);
+		WRITE_ONCE(tail_2nd->next, first);
+	}
+
+	node->locked = to_cna_node(last)->encoded_tail;
+}
+
+/*
+ * Find the first waiter in the primary queue running on our node and move
+ * the ones in front of it to the secondary queue. Nothing is moved when no
+ * such waiter is found, so remote waiters are never skipped in favour of an
+ * empty queue.
+ *
+ * Only waiters that already have a successor are looked at; the last
+ * waiter may still be linking itself in and must stay where it is.
+ */
+static void cna_order_queue(struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *first = READ_ONCE(node->next);
+	struct mcs_spinlock *last = NULL, *next = first;
+	int numa_node = to_cna_node(node)->numa_node;
+
+	while (next) {
+		if (READ_ONCE(to_cna_node(next)->numa_node) == numa_node)
+			break;
+
+		last = next;
+		next = READ_ONCE(next->next);
+	}
+
+	/* no local waiter, or our successor already is one */
+	if (!next || !last)
+		return;
+
+	cna_splice_tail(node, first, last);
+	WRITE_ONCE(node->next, next);
+}
+
+/*
+ * Called by the queue head while the lock is still owned (or pending) by
+ * someone else; use that time to reorder the queue. Always returns 0 so
+ * that the caller goes on to wait for the lock itself.
+ */
+static u32 cna_wait_head_or_lock(struct qspinlock *lock,
+				 struct mcs_spinlock *node)
+{
+	u32 stail = cna_secondary_tail(node);
+
+	if (stail) {
+		struct mcs_spinlock *tail_2nd = decode_tail(stail);
+		struct mcs_spinlock *head_2nd = READ_ONCE(tail_2nd->next);
+		struct mcs_spinlock *next = READ_ONCE(node->next);
+
+		/*
+		 * The remote waiters have waited long enough; put them
+		 * back in front of the primary queue.
+		 */
+		if (next && local_clock() - to_cna_node(head_2nd)->start_time >
+			    cna_threshold_ns) {
+			WRITE_ONCE(tail_2nd->next, next);
+			WRITE_ONCE(node->next, head_2nd);
+			node->locked = 1;
+			return 0;
+		}
+	}
+
+	cna_order_queue(node);
+
+	return 0; /* we didn't wait, the caller does */
+}
+
+/*
+ * We're the last waiter in the primary queue. If there is a secondary queue,
+ * install its tail as the lock tail and hand the MCS lock to its head rather
+ * than clearing the tail.
+ *
+ * n,0,0 -> t',0,1 ; t' = secondary tail
+ */
+static __always_inline bool cna_try_clear_tail(struct qspinlock *lock,
+					       u32 *val,
+					       struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *tail_2nd, *head_2nd;
+	u32 stail = cna_secondary_tail(node);
+	u32 old;
+
+	if (!stail)
+		return __try_clear_tail(lock, val, node);
+
+	tail_2nd = decode_tail(stail);
+	head_2nd = READ_ONCE(tail_2nd->next);
+
+	/*
+	 * Break the circle before the tail becomes visible in the lock word,
+	 * a new waiter will link itself behind it. RELEASE orders the store
+	 * against the cmpxchg.
+	 */
+	WRITE_ONCE(tail_2nd->next, NULL);
+	old = atomic_cmpxchg_release(&lock->val, *val, stail | _Q_LOCKED_VAL);
+	if (old == *val) {
+		arch_mcs_pass_lock(&head_2nd->locked, 1);
+		return true;
+	}
+
+	WRITE_ONCE(tail_2nd->next, head_2nd);
+	*val = old;
+	return false;
+}
+
+/*
+ * Hand the MCS lock, together with the secondary queue, to our successor.
+ * cna_wait_head_or_lock() may have changed it, so don't trust @next.
+ */
+static __always_inline void cna_pass_lock(struct mcs_spinlock *node,
+					  struct mcs_spinlock *next)
+{
+	u32 val = cna_secondary_tail(node);
+
+	next = READ_ONCE(node->next);
+	arch_mcs_pass_lock(&next->locked, val ? val : 1);
+}
+
+/*
+ * Boot time selection of the slow path:
+ *
+ *   numa_spinlock=on   - use CNA whenever the native slow path is used
+ *   numa_spinlock=off  - never use CNA
+ *   numa_spinlock=auto - use CNA on multi-node systems (default)
+ *
+ * CNA never replaces a paravirt slow path; waiters there must be able to
+ * halt their vCPU.
+ */
+static int numa_spinlock_flag __initdata;
+
+static int __init numa_spinlock_setup(char *str)
+{
+	if (!strcmp(str, "auto"))
+		numa_spinlock_flag = 0;
+	else if (!strcmp(str, "on"))
+		numa_spinlock_flag = 1;
+	else if (!strcmp(str, "off"))
+		numa_spinlock_flag = -1;
+	else
+		return 0;
+
+	return 1;
+}
+__setup("numa_spinlock=", numa_spinlock_setup);
+
+void __init cna_configure_spin_lock_slowpath(void)
+{
+	if (numa_spinlock_flag < 0)
+		return;
+
+	if (numa_spinlock_flag == 0 && nr_node_ids < 2)
+		return;
+
+	if (pv_lock_ops.queued_spin_lock_slowpath !=
+	    native_queued_spin_lock_slowpath)
+		return;
+
+	pv_lock_ops.queued_spin_lock_slowpath = __cna_queued_spin_lock_slowpath;
+
+	pr_info("NUMA-aware spinlocks enabled\n");
+}
@@ -61,6 +61,8 @@
 #include <linux/jump_label.h>
 #include <linux/pfn.h>
 #include <linux/bsearch.h>
+#include <linux/hash.h>
+#include <linux/stringhash.h>
 #include <linux/dynamic_debug.h>
 #include <linux/audit.h>
 #include <uapi/linux/module.h>
@@ -427,64 +429,77 @@ static bool each_symbol_in_section(const struct symsearch *arr,
 	return false;
 }
 
-/* Returns true as soon as fn returns true, otherwise false. */
-bool each_symbol_section(bool (*fn)(const struct symsearch *arr,
-				    struct module *owner,
-				    void *data),
-			 void *data)
+static const struct symsearch vmlinux_symsearch[] = {
+	{ __start___ksymtab, __stop___ksymtab, __start___kcrctab,
+	  NOT_GPL_ONLY, false },
+	{ __start___ksymtab_gpl, __stop___ksymtab_gpl,
+	  __start___kcrctab_gpl,
+	  GPL_ONLY, false },
+	{ __start___ksymtab_gpl_future, __stop___ksymtab_gpl_future,
+	  __start___kcrctab_gpl_future,
+	  WILL_BE_GPL_ONLY, false },
+#ifdef CONFIG_UNUSED_SYMBOLS
+	{ __start___ksymtab_unused, __stop___ksymtab_unused,
+	  __start___kcrctab_unused,
+	  NOT_GPL_ONLY, true },
+	{ __start___ksymtab_unused_gpl, __stop___ksymtab_unused_gpl,
+	  __start___kcrctab_unused_gpl,
+	  GPL_ONLY, true },
+#endif
+};
+
+#define NR_SYMSEARCH	ARRAY_SIZE(vmlinux_symsearch)
+
+/* Fill in the export tables of @mod, in the same order as for vmlinux. */
+static void mod_symsearch(struct module *mod, struct symsearch *arr)
 {
-	struct module *mod;
-	static const struct symsearch arr[] = {
-		{ __start___ksymtab, __stop___ksymtab, __start___kcrctab,
+	const struct symsearch tmp[NR_SYMSEARCH] = {
+		{ mod->syms, mod->syms + mod->num_syms, mod->crcs,
 		  NOT_GPL_ONLY, false },
-		{ __start___ksymtab_gpl, __stop___ksymtab_gpl,
-		  __start___kcrctab_gpl,
+		{ mod->gpl_syms, mod->gpl_syms + mod->num_gpl_syms,
+		  mod->gpl_crcs,
 		  GPL_ONLY, false },
-		{ __start___ksymtab_gpl_future, __stop___ksymtab_gpl_future,
-		  __start___kcrctab_gpl_future,
+		{ mod->gpl_future_syms,
+		  mod->gpl_future_syms + mod->num_gpl_future_syms,
+		  mod->gpl_future_crcs,
 		  WILL_BE_GPL_ONLY, false },
 #ifdef CONFIG_UNUSED_SYMBOLS
-		{ __start___ksymtab_unused, __stop___ksymtab_unused,
-		  __start___kcrctab_unused,
+		{ mod->unused_syms,
+		  mod->unused_syms + mod->num_unused_syms,
+		  mod->unused_crcs,
 		  NOT_GPL_ONLY, true },
-		{ __start___ksymtab_unused_gpl, __stop___ksymtab_unused_gpl,
-		  __start___kcrctab_unused_gpl,
+		{ mod->unused_gpl_syms,
+		  mod->unused_gpl_syms + mod->num_unused_gpl_syms,
+		  mod->unused_gpl_crcs,
 		  GPL_ONLY, true },
 #endif
 	};
 
+	memcpy(arr, tmp, sizeof(tmp));
+}
+
+/* Returns true as soon as fn returns true, otherwise false. */
+bool each_symbol_section(bool (*fn)(const struct symsearch *arr,
+				    struct module *owner,
+				    void *data),
+			 void *data)
+{
+	struct module *mod;
+
 	module_assert_mutex_or_preempt();
 
-	if (each_symbol_in_section(arr, ARRAY_SIZE(arr), NULL, fn, data))
+	if (each_symbol_in_section(vmlinux_symsearch, NR_SYMSEARCH, NULL,
+				   fn, data))
 		return true;
 
 	list_for_each_entry_rcu(mod, &modules, list) {
-		struct symsearch arr[] = {
-			{ mod->syms, mod->syms + mod->num_syms, mod->crcs,
-			  NOT_GPL_ONLY, false },
-			{ mod->gpl_syms, mod->gpl_syms + mod->num_gpl_syms,
-			  mod->gpl_crcs,
-			  GPL_ONLY, false },
-			{ mod->gpl_future_syms,
-			  mod->gpl_future_syms + mod->num_gpl_future_syms,
-			  mod->gpl_future_crcs,
-			  WILL_BE_GPL_ONLY, false },
-#ifdef CONFIG_UNUSED_SYMBOLS
-			{ mod->unused_syms,
-			  mod->unused_syms + mod->num_unused_syms,
-			  mod->unused_crcs,
-			  NOT_GPL_ONLY, true },
-			{ mod->unused_gpl_syms,
-			  mod->unused_gpl_syms + mod->num_unused_gpl_syms,
-			  mod->unused_gpl_crcs,
-			  GPL_ONLY, true },
-#endif
-		};
+		struct symsearch arr[NR_SYMSEARCH];
 
 		if (mod->state == MODULE_STATE_UNFORMED)
 			continue;
 
-		if (each_symbol_in_section(arr, ARRAY_SIZE(arr), mod, fn, data))
+		mod_symsearch(mod, arr);
+		if (each_symbol_in_section(arr, NR_SYMSEARCH, mod, fn, data))
 			return true;
 	}
 	return false;
@@ -561,6 +576,208 @@ static bool find_symbol_in_section(const struct symsearch *syms,
 	return false;
 }
 
+#ifdef CONFIG_MODULE_SYMBOL_HASH
+/*
+ * All exported symbols, of vmlinux and of the modules past UNFORMED, hashed
+ * by name, so that finding one doesn't search the export tables of every
+ * module.  Entries are added and removed under module_mutex and are looked
+ * up under module_mutex or with preemption disabled, like the module list.
+ * Until the vmlinux symbols have been added, each_symbol_section() is used.
+ */
+#define KSYM_HASH_BITS	14
+
+struct ksym_entry {
+	struct hlist_node node;
+	const struct symsearch *syms;
+	struct module *owner;
+	unsigned int symnum;
+};
+
+struct ksym_table {
+	struct symsearch syms[NR_SYMSEARCH];
+	unsigned int num;
+	struct ksym_entry entries[];
+};
+
+static struct hlist_head ksym_hash[1 << KSYM_HASH_BITS];
+static bool ksym_hash_ready __read_mostly;
+
+static inline bool ksym_hash_enabled(void)
+{
+	return smp_load_acquire(&ksym_hash_ready);
+}
+
+static u32 ksym_hash_name(const char *name)
+{
+	return hash_32(full_name_hash(NULL, name, strlen(name)),
+		       KSYM_HASH_BITS);
+}
+
+static const char *ksym_entry_name(const struct ksym_entry *e)
+{
+	return e->syms->start[e->symnum].name;
+}
+
+static unsigned int ksym_count(const struct symsearch *arr)
+{
+	unsigned int i, num = 0;
+
+	for (i = 0; i < NR_SYMSEARCH; i++)
+		num += arr[i].stop - arr[i].start;
+	return num;
+}
+
+/* Most modules export a handful of symbols, don't vmalloc() for those. */
+static struct ksym_table *ksym_table_alloc(const struct symsearch *arr,
+					   struct module *owner,
+					   unsigned int num)
+{
+	struct ksym_table *table;
+	size_t size = sizeof(*table) + num * sizeof(table->entries[0]);
+	unsigned int i, j;
+
+	if (size <= PAGE_SIZE)
+		table = kmalloc(size, GFP_KERNEL);
+	else
+		table = vmalloc(size);
+	if (!table)
+		return NULL;
+
+	memcpy(table->syms, arr, sizeof(table->syms));
+	table->num = 0;
+	for (i = 0; i < NR_SYMSEARCH; i++) {
+		for (j = 0; j < arr[i].stop - arr[i].start; j++) {
+			struct ksym_entry *e = &table->entries[table->num++];
+
+			e->syms = &table->syms[i];
+			e->owner = owner;
+			e->symnum = j;
+		}
+	}
+	return table;
+}
+
+static void ksym_table_link(struct ksym_table *table)
+{
+	unsigned int i;
+
+	lockdep_assert_held(&module_mutex);
+
+	for (i = 0; i < table->num; i++) {
+		struct ksym_entry *e = &table->entries[i];
+
+		hlist_add_head_rcu(&e->node,
+				   &ksym_hash[ksym_hash_name(ksym_entry_name(e))]);
+	}
+}
+
+static void ksym_table_unlink(struct ksym_table *table)
+{
+	unsigned int i;
+
+	lockdep_assert_held(&module_mutex);
+
+	for (i = 0; i < table->num; i++)
+		hlist_del_rcu(&table->entries[i].node);
+}
+
+static bool find_symbol_hashed(struct find_symbol_arg *fsa)
+{
+	struct ksym_entry *e;
+
+	hlist_for_each_entry_rcu(e, &ksym_hash[ksym_hash_name(fsa->name)],
+				 node) {
+		if (!strcmp(ksym_entry_name(e), fsa->name))
+			return check_symbol(e->syms, e->owner, e->symnum, fsa);
+	}
+	return false;
+}
+
+/* Called before the module's symbols become visible. */
+static int mod_ksym_table_init(struct module *mod)
+{
+	struct symsearch arr[NR_SYMSEARCH];
+	unsigned int num;
+
+	mod_symsearch(mod, arr);
+	num = ksym_count(arr);
+	if (!num)
+		return 0;
+
+	mod->ksym_table = ksym_table_alloc(arr, mod, num);
+	return mod->ksym_table ? 0 : -ENOMEM;
+}
+
+/* Called under module_mutex, once the symbols have been verified. */
+static void mod_ksym_table_link(struct module *mod)
+{
+	if (mod->ksym_table)
+		ksym_table_link(mod->ksym_table);
+}
+
+/*
+ * Called under module_mutex when unlinking @mod from the module list, the
+ * table itself can be freed after the following synchronize_sched().
+ */
+static void mod_ksym_table_unlink(struct module *mod)
+{
+	if (mod->ksym_table)
+		ksym_table_unlink(mod->ksym_table);
+}
+
+static void mod_ksym_table_free(struct module *mod)
+{
+	kvfree(mod->ksym_table);
+	mod->ksym_table = NULL;
+}
+
+static int __init ksym_hash_init(void)
+{
+	struct ksym_table *table;
+
+	table = ksym_table_alloc(vmlinux_symsearch, NULL,
+				 ksym_count(vmlinux_symsearch));
+	if (!table) {
+		pr_warn("no memory for the symbol hash table\n");
+		return -ENOMEM;
+	}
+
+	mutex_lock(&module_mutex);
+	ksym_table_link(table);
+	smp_store_release(&ksym_hash_ready, true);
+	mutex_unlock(&module_mutex);
+	return 0;
+}
+core_initcall(ksym_hash_init);
+#else
+static inline bool ksym_hash_enabled(void)
+{
+	return false;
+}
+
+static inline bool find_symbol_hashed(struct find_symbol_arg *fsa)
+{
+	return false;
+}
+
+static inline int mod_ksym_table_init(struct module *mod)
+{
+	return 0;
+}
+
+static inline void mod_ksym_table_link(struct module *mod)
+{
+}
+
+static inline void mod_ksym_table_unlink(struct module *mod)
+{
+}
+
+static inline void mod_ksym_table_free(struct module *mod)
+{
+}
+#endif /* CONFIG_MODULE_SYMBOL_HASH */
+
 /* Find a symbol and return it, along with, (optional) crc and
  * (optional) module which owns it.  Needs preempt disabled or module_mutex. */
 const struct kernel_symbol *find_symbol(const char *name,
@@ -570,12 +787,18 @@ const struct kernel_symbol *find_symbol(const char *name,
 					bool warn)
 {
 	struct find_symbol_arg fsa;
+	bool found;
 
 	fsa.name = name;
 	fsa.gplok = gplok;
 	fsa.warn = warn;
 
-	if (each_symbol_section(find_symbol_in_section, &fsa)) {
+	if (ksym_hash_enabled())
+		found = find_symbol_hashed(&fsa);
+	else
+		found = each_symbol_section(find_symbol_in_section, &fsa);
+
+	if (found) {
 		if (owner)
 			*owner = fsa.owner;
 		if (crc)
@@ -1382,11 +1605,34 @@ static const struct kernel_symbol *resolve_symbol(struct module *mod,
 						  const char *name,
 						  char ownername[])
 {
+	bool gplok = !(mod->taints & (1 << TAINT_PROPRIETARY_MODULE));
 	struct module *owner;
 	const struct kernel_symbol *sym;
 	const s32 *crc;
+	bool warn = true;
 	int err;
 
+	/*
+	 * Most symbols come from vmlinux, which needs no reference taken, so
+	 * when lookups are cheap, try without module_mutex first.  This lets
+	 * modules loading in parallel resolve their symbols in parallel.
+	 */
+	if (ksym_hash_enabled()) {
+		preempt_disable();
+		sym = find_symbol(name, &owner, &crc, gplok, true);
+		preempt_enable();
+
+		if (sym && !owner) {
+			if (!check_version(info->sechdrs, info->index.vers,
+					   name, mod, crc))
+				sym = ERR_PTR(-EINVAL);
+			strncpy(ownername, module_name(owner), MODULE_NAME_LEN);
+			return sym;
+		}
+		/* don't warn twice about the same symbol */
+		warn = !sym;
+	}
+
 	/*
 	 * The module_mutex should not be a heavily contended lock;
 	 * if we get the occasional sleep here, we'll go an extra iteration
@@ -1394,8 +1640,7 @@ static const struct kernel_symbol *resolve_symbol(struct module *mod,
 	 */
 	sched_annotate_sleep();
 	mutex_lock(&module_mutex);
-	sym = find_symbol(name, &owner, &crc,
-			  !(mod->taints & (1 << TAINT_PROPRIETARY_MODULE)), true);
+	sym = find_symbol(name, &owner, &crc, gplok, warn);
 	if (!sym)
 		goto unlock;
 
@@ -2144,12 +2389,14 @@ static void free_module(struct module *mod)
 	mutex_lock(&module_mutex);
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
+	mod_ksym_table_unlink(mod);
 	mod_tree_remove(mod);
 	/* Remove this module from bug list, this uses list_del_rcu */
 	module_bug_cleanup(mod);
 	/* Wait for RCU-sched synchronizing before releasing mod->list and buglist. */
 	synchronize_sched();
 	mutex_unlock(&module_mutex);
+	mod_ksym_table_free(mod);
 
 	/* This may be empty, but that's OK */
 	disable_ro_nx(&mod->init_layout);
@@ -3547,6 +3794,10 @@ static int complete_formation(struct module *mod, struct load_info *info)
 {
 	int err;
 
+	err = mod_ksym_table_init(mod);
+	if (err)
+		return err;
+
 	mutex_lock(&module_mutex);
 
 	/* Find duplicate symbols (must be called under lock). */
@@ -3554,6 +3805,8 @@ static int complete_formation(struct module *mod, struct load_info *info)
 	if (err < 0)
 		goto out;
 
+	mod_ksym_table_link(mod);
+
 	/* This relies on module_mutex for list integrity. */
 	module_bug_finalize(info->hdr, info->sechdrs, mod);
 
@@ -3569,6 +3822,7 @@ static int complete_formation(struct module *mod, struct load_info *info)
 
 out:
 	mutex_unlock(&module_mutex);
+	mod_ksym_table_free(mod);
 	return err;
 }
 
@@ -3769,11 +4023,13 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	mutex_lock(&module_mutex);
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
+	mod_ksym_table_unlink(mod);
 	mod_tree_remove(mod);
 	wake_up_all(&module_wq);
 	/* Wait for RCU-sched synchronizing before releasing mod->list. */
 	synchronize_sched();
 	mutex_unlock(&module_mutex);
+	mod_ksym_table_free(mod);
  free_module:
 	/*
 	 * Ftrace needs to clean up what it initialized.
@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/utsname.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
@@ -1693,12 +1694,41 @@ static size_t log_output(int facility, int level, enum log_flags lflags, const c
 	return log_store(facility, level, lflags, 0, dict, dictlen, text, text_len);
 }
 
+/*
+ * Messages are formatted into a per-CPU buffer with interrupts disabled, so
+ * logbuf_lock is only held while the result is copied into the log buffer.
+ * Recursive printk() calls and NMIs are diverted to the printk-safe buffers.
+ */
+static DEFINE_PER_CPU(char [LOG_LINE_MAX], printk_textbuf);
+
+/*
+ * Console output is normally handed off to the printk kthread so that the
+ * caller of printk() does not end up flushing the log buffer to slow
+ * consoles. Printing is done synchronously from printk() while the kthread
+ * is not running yet, when the system is going down (oops, panic, reboot),
+ * or when asked for with printk.synchronous=1.
+ */
+static bool printk_synchronous;
+module_param_named(synchronous, printk_synchronous, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(synchronous, "print to consoles from the printk() caller");
+
+static struct task_struct *printk_kthread __read_mostly;
+
+static inline bool console_offload(void)
+{
+	if (!printk_kthread || printk_synchronous)
+		return false;
+
+	return !oops_in_progress && system_state == SYSTEM_RUNNING;
+}
+
+static void defer_console_output(void);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
 {
-	static char textbuf[LOG_LINE_MAX];
-	char *text = textbuf;
+	char *text;
 	size_t text_len = 0;
 	enum log_flags lflags = 0;
 	unsigned long flags;
@@ -1713,13 +1743,13 @@ asmlinkage int vprintk_emit(int facility, int level,
 	boot_delay_msec(level);
 	printk_delay();
 
-	/* This stops the holder of console_sem just where we want him */
-	logbuf_lock_irqsave(flags);
+	printk_safe_enter_irqsave(flags);
 	/*
 	 * The printf needs to come first; we need the syslog
 	 * prefix which might be passed-in as a parameter.
 	 */
-	text_len = vscnprintf(text, sizeof(textbuf), fmt, args);
+	text = this_cpu_ptr(printk_textbuf);
+	text_len = vscnprintf(text, LOG_LINE_MAX, fmt, args);
 
 	/* mark and strip a trailing newline */
 	if (text_len && text[text_len-1] == '\n') {
@@ -1755,18 +1785,24 @@ asmlinkage int vprintk_emit(int facility, int level,
 	if (dict)
 		lflags |= LOG_PREFIX|LOG_NEWLINE;
 
+	/* This stops the holder of console_sem just where we want him */
+	raw_spin_lock(&logbuf_lock);
 	printed_len += log_output(facility, level, lflags, dict, dictlen, text, text_len);
+	raw_spin_unlock(&logbuf_lock);
 
-	logbuf_unlock_irqrestore(flags);
+	printk_safe_exit_irqrestore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
 	if (!in_sched) {
 		/*
-		 * Try to acquire and then immediately release the console
+		 * Either leave the console output to the printk kthread, or
+		 * try to acquire and then immediately release the console
 		 * semaphore.  The release will print out buffers and wake up
 		 * /dev/kmsg and syslog() users.
 		 */
-		if (console_trylock())
+		if (console_offload())
+			defer_console_output();
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -2667,8 +2703,10 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
+		if (console_offload())
+			wake_up_process(printk_kthread);
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -2691,6 +2729,14 @@ void wake_up_klogd(void)
 	preempt_enable();
 }
 
+static void defer_console_output(void)
+{
+	preempt_disable();
+	this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
+	irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
+	preempt_enable();
+}
+
 int printk_deferred(const char *fmt, ...)
 {
 	va_list args;
@@ -2701,13 +2747,67 @@ int printk_deferred(const char *fmt, ...)
 	r = vprintk_emit(0, LOGLEVEL_SCHED, NULL, 0, fmt, args);
 	va_end(args);
 
-	__this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
-	irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
+	defer_console_output();
 	preempt_enable();
 
 	return r;
 }
 
+/*
+ * Returns whether messages are waiting for a console which can print them,
+ * and where the consoles are at in @seq.
+ */
+static bool printk_kthread_need_flush(u64 *seq)
+{
+	unsigned long flags;
+	bool ret;
+
+	logbuf_lock_irqsave(flags);
+	ret = console_seq != log_next_seq;
+	*seq = console_seq;
+	logbuf_unlock_irqrestore(flags);
+
+	return ret && !console_suspended;
+}
+
+static int printk_kthread_func(void *data)
+{
+	u64 seq, last_seq = ULLONG_MAX;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		/*
+		 * Also wait for the next wakeup if the last pass didn't get
+		 * anything printed, rather than retrying in a loop.
+		 */
+		if (!printk_kthread_need_flush(&seq) || seq == last_seq)
+			schedule();
+		__set_current_state(TASK_RUNNING);
+		last_seq = seq;
+
+		console_lock();
+		console_unlock();
+		cond_resched();
+	}
+
+	return 0;
+}
+
+static int __init init_printk_kthread(void)
+{
+	struct task_struct *thread;
+
+	thread = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(thread)) {
+		pr_err("printk: unable to create printing thread\n");
+		return PTR_ERR(thread);
+	}
+
+	printk_kthread = thread;
+	return 0;
+}
+late_initcall(init_printk_kthread);
+
 /*
  * printk rate limiting, lifted from the networking subsystem.
  *
@@ -57,6 +57,8 @@
 #include <linux/random.h>
 #include <linux/trace_events.h>
 #include <linux/suspend.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "tree.h"
 #include "rcu.h"
@@ -3299,19 +3301,297 @@ void call_rcu_bh(struct rcu_head *head, rcu_callback_t func)
 EXPORT_SYMBOL_GPL(call_rcu_bh);
 
 /*
- * Queue an RCU callback for lazy invocation after a grace period.
- * This will likely be later named something like "call_rcu_lazy()",
- * but this change will require some way of tagging the lazy RCU
- * callbacks in the list of pending callbacks. Until then, this
- * function may only be called from __kfree_rcu().
+ * kfree_rcu() batching.
+ *
+ * Rather than queueing one callback per object, kfree_call_rcu() collects
+ * the pointers to be freed in per-CPU page-sized arrays. Every
+ * KFREE_DRAIN_JIFFIES, the pending arrays are handed to a batch that waits
+ * for a single grace period and then frees them with kfree_bulk() from a
+ * workqueue. When no array page can be allocated, the object's own rcu_head
+ * is chained onto a per-CPU list instead and freed with the same batch.
+ *
+ * rcu_barrier() also waits for the objects passed to kfree_rcu(), see
+ * kfree_rcu_barrier(): a module may still have objects of its own
+ * kmem_cache in a batch when it destroys the cache.
+ */
+
+/* Maximum number of jiffies to wait before draining a batch. */
+#define KFREE_DRAIN_JIFFIES (HZ / 50)
+#define KFREE_N_BATCHES 2
+
+struct kfree_rcu_bulk_data {
+	unsigned long nr_records;
+	struct kfree_rcu_bulk_data *next;
+	void *records[];
+};
+
+#define KFREE_BULK_MAX_ENTR \
+	((PAGE_SIZE - sizeof(struct kfree_rcu_bulk_data)) / sizeof(void *))
+
+/*
+ * A batch of objects waiting for a grace period: the array pages in
+ * ->bhead_free and the rcu_heads in ->head_free. The batch is in flight,
+ * and may not be reused, as long as either list is non-empty.
+ */
+struct kfree_rcu_cpu_work {
+	struct rcu_head rcu_head;
+	struct work_struct work;
+	struct kfree_rcu_bulk_data *bhead_free;
+	struct rcu_head *head_free;
+	struct kfree_rcu_cpu *krcp;
+};
+
+/*
+ * Per-CPU kfree_rcu() state; ->bhead and ->head collect new objects until
+ * kfree_rcu_monitor() moves them into a free batch slot of ->krw_arr.
+ * ->bcached keeps one spare array page around to avoid page allocator
+ * round trips.
+ */
+struct kfree_rcu_cpu {
+	struct rcu_head *head;
+	struct kfree_rcu_bulk_data *bhead;
+	struct kfree_rcu_bulk_data *bcached;
+	struct kfree_rcu_cpu_work krw_arr[KFREE_N_BATCHES];
+	spinlock_t lock;
+	struct delayed_work monitor_work;
+	bool monitor_todo;
+	bool initialized;
+};
+
+static DEFINE_PER_CPU(struct kfree_rcu_cpu, krc);
+
+/* Set once delayed work can be used to drain the batches. */
+static bool kfree_rcu_monitor_ready;
+
+/*
+ * Free the objects of a batch whose grace period has elapsed.
+ */
+static void kfree_rcu_work(struct work_struct *work)
+{
+	struct kfree_rcu_cpu_work *krwp =
+		container_of(work, struct kfree_rcu_cpu_work, work);
+	struct kfree_rcu_cpu *krcp = krwp->krcp;
+	struct kfree_rcu_bulk_data *bhead, *bnext;
+	struct rcu_head *head, *next;
+	unsigned long flags;
+
+	spin_lock_irqsave(&krcp->lock, flags);
+	bhead = krwp->bhead_free;
+	krwp->bhead_free = NULL;
+	head = krwp->head_free;
+	krwp->head_free = NULL;
+	spin_unlock_irqrestore(&krcp->lock, flags);
+
+	for (; bhead; bhead = bnext) {
+		bnext = bhead->next;
+
+		rcu_lock_acquire(&rcu_callback_map);
+		kfree_bulk(bhead->nr_records, bhead->records);
+		rcu_lock_release(&rcu_callback_map);
+
+		if (cmpxchg(&krcp->bcached, NULL, bhead))
+			free_page((unsigned long)bhead);
+
+		cond_resched();
+	}
+
+	for (; head; head = next) {
+		unsigned long offset = (unsigned long)head->func;
+
+		next = head->next;
+		debug_rcu_head_unqueue(head);
+		rcu_lock_acquire(&rcu_callback_map);
+		trace_rcu_invoke_kfree_callback(rcu_state_p->name, head, offset);
+		if (!WARN_ON_ONCE(!__is_kfree_rcu_offset(offset)))
+			kfree((void *)head - offset);
+		rcu_lock_release(&rcu_callback_map);
+
+		cond_resched();
+	}
+}
+
+/*
+ * The grace period of a batch has elapsed; leave the freeing to process
+ * context so that it does not add to softirq time.
+ */
+static void kfree_rcu_batch_gp_done(struct rcu_head *rhp)
+{
+	struct kfree_rcu_cpu_work *krwp =
+		container_of(rhp, struct kfree_rcu_cpu_work, rcu_head);
+
+	queue_work(system_wq, &krwp->work);
+}
+
+/*
+ * Move the pending objects into a free batch slot and start its grace
+ * period. Returns false if all slots are still in flight.
+ */
+static bool queue_kfree_rcu_work(struct kfree_rcu_cpu *krcp)
+{
+	struct kfree_rcu_cpu_work *krwp;
+	int i;
+
+	lockdep_assert_held(&krcp->lock);
+
+	/* Already drained by kfree_rcu_barrier() */
+	if (!krcp->bhead && !krcp->head)
+		return true;
+
+	for (i = 0; i < KFREE_N_BATCHES; i++) {
+		krwp = &krcp->krw_arr[i];
+		if (krwp->bhead_free || krwp->head_free)
+			continue;
+
+		krwp->bhead_free = krcp->bhead;
+		krcp->bhead = NULL;
+		krwp->head_free = krcp->head;
+		krcp->head = NULL;
+
+		call_rcu(&krwp->rcu_head, kfree_rcu_batch_gp_done);
+		return true;
+	}
+
+	return false;
+}
+
+static void kfree_rcu_monitor(struct work_struct *work)
+{
+	struct kfree_rcu_cpu *krcp = container_of(work, struct kfree_rcu_cpu,
+						  monitor_work.work);
+	unsigned long flags;
+
+	spin_lock_irqsave(&krcp->lock, flags);
+	if (krcp->monitor_todo) {
+		krcp->monitor_todo = false;
+		if (!queue_kfree_rcu_work(krcp)) {
+			/* Previous batches still in flight, try again later. */
+			krcp->monitor_todo = true;
+			schedule_delayed_work(&krcp->monitor_work,
+					      KFREE_DRAIN_JIFFIES);
+		}
+	}
+	spin_unlock_irqrestore(&krcp->lock, flags);
+}
+
+static bool kfree_call_rcu_add_ptr_to_bulk(struct kfree_rcu_cpu *krcp,
+					   struct rcu_head *head,
+					   rcu_callback_t func)
+{
+	struct kfree_rcu_bulk_data *bnode;
+
+	lockdep_assert_held(&krcp->lock);
+
+	if (!krcp->bhead || krcp->bhead->nr_records == KFREE_BULK_MAX_ENTR) {
+		bnode = xchg(&krcp->bcached, NULL);
+		if (!bnode)
+			bnode = (struct kfree_rcu_bulk_data *)
+				__get_free_page(GFP_NOWAIT | __GFP_NOWARN);
+
+		/* Out of memory, use the object's rcu_head instead. */
+		if (unlikely(!bnode))
+			return false;
+
+		bnode->nr_records = 0;
+		bnode->next = krcp->bhead;
+		krcp->bhead = bnode;
+	}
+
+	krcp->bhead->records[krcp->bhead->nr_records++] =
+		(void *)head - (unsigned long)func;
+
+	return true;
+}
+
+/*
+ * Queue an object for freeing after a grace period; see the kfree_rcu()
+ * batching comment above. This function may only be called from
+ * __kfree_rcu().
  */
 void kfree_call_rcu(struct rcu_head *head,
 		    rcu_callback_t func)
 {
-	__call_rcu(head, func, rcu_state_p, -1, 1);
+	struct kfree_rcu_cpu *krcp;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	krcp = this_cpu_ptr(&krc);
+	if (unlikely(!krcp->initialized)) {
+		/* Very early boot, before rcu_init(). */
+		local_irq_restore(flags);
+		__call_rcu(head, func, rcu_state_p, -1, 1);
+		return;
+	}
+
+	spin_lock(&krcp->lock);
+	if (!kfree_call_rcu_add_ptr_to_bulk(krcp, head, func)) {
+		if (debug_rcu_head_queue(head)) {
+			/* Probable double kfree_rcu(), just leak. */
+			WARN_ONCE(1, "%s(): Double-freed call. rcu_head %p\n",
+				  __func__, head);
+			goto unlock_return;
+		}
+		head->func = func;
+		head->next = krcp->head;
+		krcp->head = head;
+	}
+
+	/* Drain the batch after KFREE_DRAIN_JIFFIES. */
+	if (kfree_rcu_monitor_ready && !krcp->monitor_todo) {
+		krcp->monitor_todo = true;
+		schedule_delayed_work(&krcp->monitor_work, KFREE_DRAIN_JIFFIES);
+	}
+
+unlock_return:
+	spin_unlock(&krcp->lock);
+	local_irq_restore(flags);
 }
 EXPORT_SYMBOL_GPL(kfree_call_rcu);
 
+static void __init kfree_rcu_batch_init(void)
+{
+	int cpu;
+	int i;
+
+	for_each_possible_cpu(cpu) {
+		struct kfree_rcu_cpu *krcp = per_cpu_ptr(&krc, cpu);
+
+		spin_lock_init(&krcp->lock);
+		for (i = 0; i < KFREE_N_BATCHES; i++) {
+			INIT_WORK(&krcp->krw_arr[i].work, kfree_rcu_work);
+			krcp->krw_arr[i].krcp = krcp;
+		}
+		INIT_DELAYED_WORK(&krcp->monitor_work, kfree_rcu_monitor);
+		krcp->initialized = true;
+	}
+}
+
+/*
+ * Objects queued during early boot wait for the first drain that can be
+ * scheduled from here on.
+ */
+static int __init kfree_rcu_monitor_init(void)
+{
+	unsigned long flags;
+	int cpu;
+
+	WRITE_ONCE(kfree_rcu_monitor_ready, true);
+
+	for_each_possible_cpu(cpu) {
+		struct kfree_rcu_cpu *krcp = per_cpu_ptr(&krc, cpu);
+
+		spin_lock_irqsave(&krcp->lock, flags);
+		if ((krcp->bhead || krcp->head) && !krcp->monitor_todo) {
+			krcp->monitor_todo = true;
+			schedule_delayed_work_on(cpu, &krcp->monitor_work,
+						 KFREE_DRAIN_JIFFIES);
+		}
+		spin_unlock_irqrestore(&krcp->lock, flags);
+	}
+
+	return 0;
+}
+core_initcall(kfree_rcu_monitor_init);
+
 /*
  * Because a context switch is a grace period for RCU-sched and RCU-bh,
  * any blocking grace-period wait automatically implies a grace period
@@ -3790,6 +4070,54 @@ static void _rcu_barrier(struct rcu_state *rsp)
 	mutex_unlock(&rsp->barrier_mutex);
 }
 
+/*
+ * Wait until every object passed to kfree_rcu() so far has been freed:
+ * hand the pending objects to batches, wait for the grace period
+ * callbacks of the batches, then for the works freeing them. Batches
+ * still in flight may keep the pending objects waiting, hence the loop.
+ */
+static void kfree_rcu_barrier(void)
+{
+	struct kfree_rcu_cpu *krcp;
+	bool busy, pending;
+	unsigned long flags;
+	int cpu, i;
+
+	/* Before that, kfree_rcu() objects are queued with __call_rcu() */
+	if (!READ_ONCE(kfree_rcu_monitor_ready))
+		return;
+
+	do {
+		busy = pending = false;
+		for_each_possible_cpu(cpu) {
+			krcp = per_cpu_ptr(&krc, cpu);
+
+			spin_lock_irqsave(&krcp->lock, flags);
+			if (krcp->bhead || krcp->head) {
+				if (queue_kfree_rcu_work(krcp))
+					krcp->monitor_todo = false;
+				else
+					pending = true;
+			}
+			for (i = 0; i < KFREE_N_BATCHES; i++) {
+				if (krcp->krw_arr[i].bhead_free ||
+				    krcp->krw_arr[i].head_free)
+					busy = true;
+			}
+			spin_unlock_irqrestore(&krcp->lock, flags);
+		}
+		if (!busy)
+			break;
+
+		_rcu_barrier(rcu_state_p);
+		for_each_possible_cpu(cpu) {
+			krcp = per_cpu_ptr(&krc, cpu);
+			for (i = 0; i < KFREE_N_BATCHES; i++)
+				flush_work(&krcp->krw_arr[i].work);
+		}
+	} while (pending);
+}
+
 /**
  * rcu_barrier_bh - Wait until all in-flight call_rcu_bh() callbacks complete.
  */
@@ -4315,6 +4643,7 @@ void __init rcu_init(void)
 	rcu_early_boot_tests();
 
 	rcu_bootup_announce();
+	kfree_rcu_batch_init();
 	rcu_init_geometry();
 	rcu_init_one(&rcu_bh_state);
 	rcu_init_one(&rcu_sched_state);
@@ -691,6 +691,7 @@ EXPORT_SYMBOL_GPL(synchronize_rcu);
  */
 void rcu_barrier(void)
 {
+	kfree_rcu_barrier();
 	_rcu_barrier(rcu_state_p);
 }
 EXPORT_SYMBOL_GPL(rcu_barrier);
@@ -810,6 +811,7 @@ static void rcu_preempt_check_callbacks(void)
  */
 void rcu_barrier(void)
 {
+	kfree_rcu_barrier();
 	rcu_barrier_sched();
 }
 EXPORT_SYMBOL_GPL(rcu_barrier);
@@ -3999,17 +3999,30 @@ static inline u64 sched_cfs_bandwidth_slice(void)
  * We use sched_clock_cpu directly instead of rq->clock to avoid adding
  * additional synchronization around rq->lock.
  *
+ * Runtime left unused in the global pool is carried over into the next
+ * period, up to quota + burst; a period that consumed more than its quota
+ * out of that accumulated runtime is accounted as a burst.
+ *
  * requires cfs_b->lock
  */
 void __refill_cfs_bandwidth_runtime(struct cfs_bandwidth *cfs_b)
 {
+	s64 runtime;
 	u64 now;
 
 	if (cfs_b->quota == RUNTIME_INF)
 		return;
 
 	now = sched_clock_cpu(smp_processor_id());
-	cfs_b->runtime = cfs_b->quota;
+	cfs_b->runtime += cfs_b->quota;
+	runtime = cfs_b->runtime_snap - cfs_b->runtime;
+	if (runtime > 0) {
+		cfs_b->burst_time += runtime;
+		cfs_b->nr_burst++;
+	}
+
+	cfs_b->runtime = min(cfs_b->runtime, cfs_b->quota + cfs_b->burst);
+	cfs_b->runtime_snap = cfs_b->runtime;
 	cfs_b->runtime_expires = now + ktime_to_ns(cfs_b->period);
 }
 
@@ -4434,6 +4447,15 @@ static void start_cfs_slack_bandwidth(struct cfs_bandwidth *cfs_b)
 	if (runtime_refresh_within(cfs_b, min_left))
 		return;
 
+	/*
+	 * Don't push an already armed timer forward: with cfs_rqs returning
+	 * slack all the time, the throttled ones would only ever see it
+	 * again at the next quota refresh.
+	 */
+	if (cfs_b->slack_started)
+		return;
+	cfs_b->slack_started = true;
+
 	hrtimer_start(&cfs_b->slack_timer,
 			ns_to_ktime(cfs_bandwidth_slack_period),
 			HRTIMER_MODE_REL);
@@ -4486,6 +4508,7 @@ static void do_sched_cfs_slack_timer(struct cfs_bandwidth *cfs_b)
 
 	/* confirm we're still not at a refresh boundary */
 	raw_spin_lock(&cfs_b->lock);
+	cfs_b->slack_started = false;
 	if (runtime_refresh_within(cfs_b, min_bandwidth_expiration)) {
 		raw_spin_unlock(&cfs_b->lock);
 		return;
@@ -5566,11 +5589,11 @@ find_idlest_group(struct sched_domain *sd, struct task_struct *p,
 	if (sd_flag & SD_BALANCE_FORK)
 		goto skip_spare;
 
-	if (this_spare > task_util(p) / 2 &&
+	if (this_spare > uclamp_task_util(p, task_util(p)) / 2 &&
 	    imbalance_scale*this_spare > 100*most_spare)
 		return NULL;
 
-	if (most_spare > task_util(p) / 2)
+	if (most_spare > uclamp_task_util(p, task_util(p)) / 2)
 		return most_spare_sg;
 
 skip_spare:
@@ -5677,6 +5700,47 @@ static int cpumask_next_wrap(int n, const struct cpumask *mask, int start, int *
 		(cpu) = cpumask_next_wrap((cpu), (mask), (start), &(wrap)),	\
 		(cpu) < nr_cpumask_bits; )
 
+/*
+ * Keep sd_llc_shared->idle_masks in sync on idle entry and exit. A CPU only
+ * ever writes its own bits of the idle CPUs mask, and only when they change;
+ * the idle cores mask is set in __update_idle_core() below.
+ */
+void update_idle_cpumask(struct rq *rq, bool idle)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+#ifdef CONFIG_SCHED_SMT
+	int sibling;
+#endif
+
+	if (!sched_feat(SIS_IDLE_MASK))
+		return;
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (!sds)
+		goto unlock;
+
+	if (idle) {
+		if (!cpumask_test_cpu(cpu, sds_idle_cpus(sds)))
+			cpumask_set_cpu(cpu, sds_idle_cpus(sds));
+		goto unlock;
+	}
+
+	if (cpumask_test_cpu(cpu, sds_idle_cpus(sds)))
+		cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+
+#ifdef CONFIG_SCHED_SMT
+	/* The core of this CPU is no longer idle either. */
+	if (cpumask_test_cpu(cpu, sds_idle_cores(sds))) {
+		for_each_cpu(sibling, cpu_smt_mask(cpu))
+			cpumask_clear_cpu(sibling, sds_idle_cores(sds));
+	}
+#endif
+unlock:
+	rcu_read_unlock();
+}
+
 #ifdef CONFIG_SCHED_SMT
 
 static inline void set_idle_cores(int cpu, int val)
@@ -5708,12 +5772,25 @@ static inline bool test_idle_cores(int cpu, bool def)
  */
 void __update_idle_core(struct rq *rq)
 {
+	struct sched_domain_shared *sds;
 	int core = cpu_of(rq);
 	int cpu;
 
 	rcu_read_lock();
-	if (test_idle_cores(core, true))
+	sds = rcu_dereference(per_cpu(sd_llc_shared, core));
+	if (sched_feat(SIS_IDLE_MASK) && sds) {
+		/*
+		 * Already in the mask, but select_idle_core() may have
+		 * cleared has_idle_cores meanwhile: re-arm it.
+		 */
+		if (cpumask_test_cpu(core, sds_idle_cores(sds))) {
+			if (!test_idle_cores(core, true))
+				set_idle_cores(core, 1);
+			goto unlock;
+		}
+	} else if (test_idle_cores(core, true)) {
 		goto unlock;
+	}
 
 	for_each_cpu(cpu, cpu_smt_mask(core)) {
 		if (cpu == core)
@@ -5723,7 +5800,13 @@ void __update_idle_core(struct rq *rq)
 			goto unlock;
 	}
 
-	set_idle_cores(core, 1);
+	if (!test_idle_cores(core, true))
+		set_idle_cores(core, 1);
+
+	if (sched_feat(SIS_IDLE_MASK) && sds) {
+		for_each_cpu(cpu, cpu_smt_mask(core))
+			cpumask_set_cpu(cpu, sds_idle_cores(sds));
+	}
 unlock:
 	rcu_read_unlock();
 }
@@ -5732,10 +5815,15 @@ void __update_idle_core(struct rq *rq)
  * Scan the entire LLC domain for idle cores; this dynamically switches off if
  * there are no idle cores left in the system; tracked through
  * sd_llc->shared->has_idle_cores and enabled through update_idle_core() above.
+ *
+ * With SIS_IDLE_MASK only the cores in sd_llc->shared's idle cores mask are
+ * looked at; stale ones are dropped from it.
  */
-static int select_idle_core(struct task_struct *p, struct sched_domain *sd, int target)
+static int select_idle_core(struct task_struct *p, struct sched_domain *sd,
+			    int target, int *nr)
 {
 	struct cpumask *cpus = this_cpu_cpumask_var_ptr(select_idle_mask);
+	struct sched_domain_shared *sds = NULL;
 	int core, cpu, wrap;
 
 	if (!static_branch_likely(&sched_smt_present))
@@ -5746,17 +5834,29 @@ static int select_idle_core(struct task_struct *p, struct sched_domain *sd, int
 
 	cpumask_and(cpus, sched_domain_span(sd), &p->cpus_allowed);
 
+	if (sched_feat(SIS_IDLE_MASK)) {
+		sds = rcu_dereference(per_cpu(sd_llc_shared, target));
+		if (sds)
+			cpumask_and(cpus, cpus, sds_idle_cores(sds));
+	}
+
 	for_each_cpu_wrap(core, cpus, target, wrap) {
 		bool idle = true;
 
 		for_each_cpu(cpu, cpu_smt_mask(core)) {
 			cpumask_clear_cpu(cpu, cpus);
+			(*nr)++;
 			if (!idle_cpu(cpu))
 				idle = false;
 		}
 
 		if (idle)
 			return core;
+
+		if (sds) {
+			for_each_cpu(cpu, cpu_smt_mask(core))
+				cpumask_clear_cpu(cpu, sds_idle_cores(sds));
+		}
 	}
 
 	/*
@@ -5770,7 +5870,8 @@ static int select_idle_core(struct task_struct *p, struct sched_domain *sd, int
 /*
  * Scan the local SMT mask for idle CPUs.
  */
-static int select_idle_smt(struct task_struct *p, struct sched_domain *sd, int target)
+static int select_idle_smt(struct task_struct *p, struct sched_domain *sd,
+			   int target, int *nr)
 {
 	int cpu;
 
@@ -5780,6 +5881,7 @@ static int select_idle_smt(struct task_struct *p, struct sched_domain *sd, int t
 	for_each_cpu(cpu, cpu_smt_mask(target)) {
 		if (!cpumask_test_cpu(cpu, &p->cpus_allowed))
 			continue;
+		(*nr)++;
 		if (idle_cpu(cpu))
 			return cpu;
 	}
@@ -5789,24 +5891,51 @@ static int select_idle_smt(struct task_struct *p, struct sched_domain *sd, int t
 
 #else /* CONFIG_SCHED_SMT */
 
-static inline int select_idle_core(struct task_struct *p, struct sched_domain *sd, int target)
+static inline int select_idle_core(struct task_struct *p, struct sched_domain *sd,
+				   int target, int *nr)
 {
 	return -1;
 }
 
-static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd, int target)
+static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd,
+				  int target, int *nr)
 {
 	return -1;
 }
 
 #endif /* CONFIG_SCHED_SMT */
 
+/*
+ * Pick an idle CPU from the idle CPUs mask of the LLC. A CPU is in the mask
+ * from its idle entry to its idle exit, so the first allowed CPU found is
+ * idle but for a wakeup already on its way to it.
+ */
+static int select_idle_cpu_mask(struct task_struct *p, struct sched_domain *sd,
+				struct sched_domain_shared *sds, int target,
+				int *nr)
+{
+	struct cpumask *cpus = this_cpu_cpumask_var_ptr(select_idle_mask);
+	int cpu, wrap;
+
+	cpumask_and(cpus, sds_idle_cpus(sds), sched_domain_span(sd));
+	cpumask_and(cpus, cpus, &p->cpus_allowed);
+
+	for_each_cpu_wrap(cpu, cpus, target, wrap) {
+		(*nr)++;
+		if (idle_cpu(cpu))
+			return cpu;
+	}
+
+	return -1;
+}
+
 /*
  * Scan the LLC domain for idle CPUs; this is dynamically regulated by
  * comparing the average scan cost (tracked in sd->avg_scan_cost) against the
  * average idle time for this rq (as found in rq->avg_idle).
  */
-static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int target)
+static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd,
+			   int target, int *nr)
 {
 	struct sched_domain *this_sd;
 	u64 avg_cost, avg_idle = this_rq()->avg_idle;
@@ -5814,6 +5943,14 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	s64 delta;
 	int cpu, wrap;
 
+	if (sched_feat(SIS_IDLE_MASK)) {
+		struct sched_domain_shared *sds;
+
+		sds = rcu_dereference(per_cpu(sd_llc_shared, target));
+		if (sds)
+			return select_idle_cpu_mask(p, sd, sds, target, nr);
+	}
+
 	this_sd = rcu_dereference(*this_cpu_ptr(&sd_llc));
 	if (!this_sd)
 		return -1;
@@ -5832,6 +5969,7 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	for_each_cpu_wrap(cpu, sched_domain_span(sd), target, wrap) {
 		if (!cpumask_test_cpu(cpu, &p->cpus_allowed))
 			continue;
+		(*nr)++;
 		if (idle_cpu(cpu))
 			break;
 	}
@@ -5850,7 +5988,7 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 static int select_idle_sibling(struct task_struct *p, int prev, int target)
 {
 	struct sched_domain *sd;
-	int i;
+	int i, nr = 0;
 
 	if (idle_cpu(target))
 		return target;
@@ -5865,19 +6003,22 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	if (!sd)
 		return target;
 
-	i = select_idle_core(p, sd, target);
+	i = select_idle_core(p, sd, target, &nr);
 	if ((unsigned)i < nr_cpumask_bits)
-		return i;
+		goto out;
 
-	i = select_idle_cpu(p, sd, target);
+	i = select_idle_cpu(p, sd, target, &nr);
 	if ((unsigned)i < nr_cpumask_bits)
-		return i;
+		goto out;
 
-	i = select_idle_smt(p, sd, target);
+	i = select_idle_smt(p, sd, target, &nr);
 	if ((unsigned)i < nr_cpumask_bits)
-		return i;
+		goto out;
 
-	return target;
+	i = target;
+out:
+	trace_sched_select_idle_sibling(p, target, i, nr);
+	return i;
 }
 
 /*
@@ -5958,7 +6099,7 @@ static int wake_cap(struct task_struct *p, int cpu, int prev_cpu)
 	/* Bring task utilization in sync with prev_cpu */
 	sync_entity_load_avg(&p->se);
 
-	return min_cap * 1024 < task_util(p) * capacity_margin;
+	return min_cap * 1024 < uclamp_task_util(p, task_util(p)) * capacity_margin;
 }
 
 /*
@@ -56,6 +56,12 @@ SCHED_FEAT(TTWU_QUEUE, true)
  */
 SCHED_FEAT(SIS_AVG_CPU, false)
 
+/*
+ * Look for idle cores and CPUs in the idle masks of the LLC, maintained
+ * on idle entry and exit, instead of scanning the whole LLC domain.
+ */
+SCHED_FEAT(SIS_IDLE_MASK, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
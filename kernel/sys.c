@@ -31,6 +31,7 @@
 #include <linux/getcpu.h>
 #include <linux/task_io_accounting_ops.h>
 #include <linux/seccomp.h>
+#include <linux/futex.h>
 #include <linux/cpu.h>
 #include <linux/personality.h>
 #include <linux/ptrace.h>
@@ -2290,6 +2291,31 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 	case PR_GET_FP_MODE:
 		error = GET_FP_MODE(me);
 		break;
+	case PR_SET_FUTEX_HASH:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = futex_hash_prctl_set(arg2);
+		break;
+	case PR_GET_FUTEX_HASH:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = futex_hash_prctl_get();
+		break;
+	case PR_SET_LAZY_FORK:
+		if (!IS_ENABLED(CONFIG_LAZY_FORK_PGTABLES))
+			return -EINVAL;
+		if (arg2 > 1 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		if (arg2)
+			set_bit(MMF_LAZY_FORK, &me->mm->flags);
+		else
+			clear_bit(MMF_LAZY_FORK, &me->mm->flags);
+		break;
+	case PR_GET_LAZY_FORK:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = test_bit(MMF_LAZY_FORK, &me->mm->flags);
+		break;
 	default:
 		error = -EINVAL;
 		break;
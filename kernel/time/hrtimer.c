@@ -1239,12 +1239,20 @@ static void __run_hrtimer(struct hrtimer_cpu_base *cpu_base,
 	cpu_base->running = NULL;
 }
 
-static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now)
+/*
+ * Expire at most @budget timers. Returns true if expired timers were left
+ * over because the budget ran out.
+ */
+static bool __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
+				 unsigned int budget)
 {
 	struct hrtimer_clock_base *base = cpu_base->clock_base;
 	unsigned int active = cpu_base->active_bases;
+	unsigned int count = 0;
+	bool deferred = false;
+	s64 max_late = 0;
 
-	for (; active; base++, active >>= 1) {
+	for (; active && !deferred; base++, active >>= 1) {
 		struct timerqueue_node *node;
 		ktime_t basenow;
 
@@ -1273,13 +1281,35 @@ static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now)
 			if (basenow < hrtimer_get_softexpires_tv64(timer))
 				break;
 
+			if (count == budget) {
+				deferred = true;
+				break;
+			}
+			count++;
+			if (basenow - hrtimer_get_expires_tv64(timer) > max_late)
+				max_late = basenow - hrtimer_get_expires_tv64(timer);
+
 			__run_hrtimer(cpu_base, base, timer, &basenow);
 		}
 	}
+
+	if (count || deferred)
+		trace_hrtimer_expire_batch(cpu_base->cpu, count, max_late,
+					   deferred);
+	return deferred;
 }
 
 #ifdef CONFIG_HIGH_RES_TIMERS
 
+/*
+ * Maximum number of hrtimers expired by one hrtimer interrupt. The
+ * remaining expired timers are run by another interrupt, programmed
+ * HRTIMER_DEFER_NS later, so that a burst of expiries doesn't keep other
+ * interrupts out for too long.
+ */
+#define HRTIMER_EXPIRE_BUDGET	256
+#define HRTIMER_DEFER_NS	(10 * NSEC_PER_USEC)
+
 /*
  * High resolution timer interrupt
  * Called with interrupts disabled
@@ -1289,6 +1319,7 @@ void hrtimer_interrupt(struct clock_event_device *dev)
 	struct hrtimer_cpu_base *cpu_base = this_cpu_ptr(&hrtimer_bases);
 	ktime_t expires_next, now, entry_time, delta;
 	int retries = 0;
+	bool deferred;
 
 	BUG_ON(!cpu_base->hres_active);
 	cpu_base->nr_events++;
@@ -1307,10 +1338,14 @@ void hrtimer_interrupt(struct clock_event_device *dev)
 	 */
 	cpu_base->expires_next = KTIME_MAX;
 
-	__hrtimer_run_queues(cpu_base, now);
+	deferred = __hrtimer_run_queues(cpu_base, now, HRTIMER_EXPIRE_BUDGET);
 
 	/* Reevaluate the clock bases for the next expiry */
 	expires_next = __hrtimer_get_next_event(cpu_base);
+	if (deferred) {
+		cpu_base->nr_deferred++;
+		expires_next = ktime_add_ns(ktime_get(), HRTIMER_DEFER_NS);
+	}
 	/*
 	 * Store the new expiry value so the migration code can verify
 	 * against it.
@@ -1319,6 +1354,12 @@ void hrtimer_interrupt(struct clock_event_device *dev)
 	cpu_base->in_hrtirq = 0;
 	raw_spin_unlock(&cpu_base->lock);
 
+	/* Come back shortly for the timers left over */
+	if (deferred) {
+		tick_program_event(expires_next, 1);
+		return;
+	}
+
 	/* Reprogramming necessary ? */
 	if (!tick_program_event(expires_next, 0)) {
 		cpu_base->hang_detected = 0;
@@ -1412,7 +1453,11 @@ void hrtimer_run_queues(void)
 
 	raw_spin_lock(&cpu_base->lock);
 	now = hrtimer_update_base(cpu_base);
-	__hrtimer_run_queues(cpu_base, now);
+	/*
+	 * Not bounded: in low resolution mode, deferring would delay the
+	 * remaining timers by a whole tick.
+	 */
+	__hrtimer_run_queues(cpu_base, now, UINT_MAX);
 	raw_spin_unlock(&cpu_base->lock);
 }
 
@@ -184,6 +184,9 @@ EXPORT_SYMBOL(jiffies_64);
  */
 #define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
 
+/* Array index of expired timers left over by __run_timers() */
+#define WHEEL_IDX_EXPIRED	(TIMER_ARRAYMASK >> TIMER_ARRAYSHIFT)
+
 #ifdef CONFIG_NO_HZ_COMMON
 # define NR_BASES	2
 # define BASE_STD	0
@@ -203,6 +206,9 @@ struct timer_base {
 	bool			migration_enabled;
 	bool			nohz_active;
 	bool			is_idle;
+	bool			expired_marked;
+	unsigned int		expired_levels;
+	struct hlist_head	expired[LVL_DEPTH];
 	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
 	struct hlist_head	vectors[WHEEL_SIZE];
 } ____cacheline_aligned;
@@ -801,7 +807,8 @@ static int detach_if_pending(struct timer_list *timer, struct timer_base *base,
 	if (!timer_pending(timer))
 		return 0;
 
-	if (hlist_is_singular_node(&timer->entry, base->vectors + idx))
+	if (idx != WHEEL_IDX_EXPIRED &&
+	    hlist_is_singular_node(&timer->entry, base->vectors + idx))
 		__clear_bit(idx, base->pending_map);
 
 	detach_timer(timer, clear_pending);
@@ -1283,15 +1290,25 @@ static void call_timer_fn(struct timer_list *timer, void (*fn)(unsigned long),
 	}
 }
 
-static void expire_timers(struct timer_base *base, struct hlist_head *head)
+static unsigned int expire_timers(struct timer_base *base,
+				  struct hlist_head *head, unsigned int budget,
+				  unsigned long *max_late)
 {
-	while (!hlist_empty(head)) {
+	unsigned int count = 0;
+
+	while (!hlist_empty(head) && count < budget) {
 		struct timer_list *timer;
 		void (*fn)(unsigned long);
 		unsigned long data;
+		long late;
 
 		timer = hlist_entry(head->first, struct timer_list, entry);
 
+		late = (long) (jiffies - timer->expires);
+		if (late > (long) *max_late)
+			*max_late = late;
+		count++;
+
 		base->running_timer = timer;
 		detach_timer(timer, true);
 
@@ -1308,6 +1325,7 @@ static void expire_timers(struct timer_base *base, struct hlist_head *head)
 			spin_lock_irq(&base->lock);
 		}
 	}
+	return count;
 }
 
 static int __collect_expired_timers(struct timer_base *base,
@@ -1578,30 +1596,81 @@ void update_process_times(int user_tick)
 		run_posix_cpu_timers(p);
 }
 
+/*
+ * Timers left on the expired lists by a deferred run are still pending, but
+ * no longer in the bucket their array index points to. Give them an index
+ * which no bucket has, so that __mod_timer() doesn't mistake them for
+ * queued in the bucket it calculated and leave them to expire early.
+ */
+static void mark_expired_timers(struct timer_base *base)
+{
+	struct timer_list *timer;
+	unsigned int i;
+
+	for (i = 0; i < base->expired_levels; i++) {
+		hlist_for_each_entry(timer, base->expired + i, entry)
+			timer_set_idx(timer, WHEEL_IDX_EXPIRED);
+	}
+	base->expired_marked = true;
+}
+
+/*
+ * Maximum number of timers expired by one softirq run of a timer base.
+ * Expired timers beyond that stay on the base's expired lists and the
+ * softirq is raised again, so that other softirqs get a chance to run in
+ * between and a long backlog ends up in ksoftirqd.
+ */
+#define TIMER_EXPIRE_BUDGET	1024
+
 /**
  * __run_timers - run all expired timers (if any) on this CPU.
  * @base: the timer vector to be processed.
  */
 static inline void __run_timers(struct timer_base *base)
 {
-	struct hlist_head heads[LVL_DEPTH];
-	int levels;
+	unsigned long max_late = 0;
+	unsigned int count = 0;
+	bool deferred = false;
 
-	if (!time_after_eq(jiffies, base->clk))
+	if (!time_after_eq(jiffies, base->clk) && !base->expired_levels)
 		return;
 
 	spin_lock_irq(&base->lock);
 
-	while (time_after_eq(jiffies, base->clk)) {
+	for (;;) {
+		/* Timers left over by a deferred run go first */
+		while (base->expired_levels) {
+			struct hlist_head *head;
+
+			head = base->expired + base->expired_levels - 1;
+			count += expire_timers(base, head,
+					       TIMER_EXPIRE_BUDGET - count,
+					       &max_late);
+			if (!hlist_empty(head)) {
+				deferred = true;
+				goto out;
+			}
+			base->expired_levels--;
+		}
+
+		if (!time_after_eq(jiffies, base->clk))
+			break;
 
-		levels = collect_expired_timers(base, heads);
+		base->expired_levels = collect_expired_timers(base,
+							      base->expired);
+		base->expired_marked = false;
 		base->clk++;
-
-		while (levels--)
-			expire_timers(base, heads + levels);
 	}
+out:
+	if (deferred && !base->expired_marked)
+		mark_expired_timers(base);
 	base->running_timer = NULL;
 	spin_unlock_irq(&base->lock);
+
+	if (deferred)
+		raise_softirq(TIMER_SOFTIRQ);
+	if (count || deferred)
+		trace_timer_expire_batch(base->cpu, count, max_late, deferred);
 }
 
 /*
@@ -1793,6 +1862,9 @@ int timers_dead_cpu(unsigned int cpu)
 
 		for (i = 0; i < WHEEL_SIZE; i++)
 			migrate_timer_list(new_base, old_base->vectors + i);
+		for (i = 0; i < old_base->expired_levels; i++)
+			migrate_timer_list(new_base, old_base->expired + i);
+		old_base->expired_levels = 0;
 
 		spin_unlock(&old_base->lock);
 		spin_unlock_irq(&new_base->lock);
@@ -82,6 +82,9 @@ static struct page *follow_page_pte(struct vm_area_struct *vma,
 retry:
 	if (unlikely(pmd_bad(*pmd)))
 		return no_page_table(vma, flags);
+	/* let the fault copy a table shared on fork */
+	if ((flags & FOLL_WRITE) && pmd_shared_pgtable(*pmd))
+		return no_page_table(vma, flags);
 
 	ptep = pte_offset_map_lock(mm, pmd, address, &ptl);
 	pte = *ptep;
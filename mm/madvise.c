@@ -317,6 +317,9 @@ static int madvise_free_pte_range(pmd_t *pmd, unsigned long addr,
 
 	if (pmd_trans_unstable(pmd))
 		return 0;
+	/* the pages are still in use by another mm */
+	if (pmd_shared_pgtable(*pmd))
+		return 0;
 
 	tlb_remove_check_page_size_change(tlb, PAGE_SIZE);
 	orig_pte = pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
@@ -550,6 +553,8 @@ static long madvise_dontneed(struct vm_area_struct *vma,
 		}
 		VM_WARN_ON(start >= end);
 	}
+	if (unshare_partial_pte_tables(vma->vm_mm, start, end))
+		return -ENOMEM;
 	zap_page_range(vma, start, end - start);
 	return 0;
 }
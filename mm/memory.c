@@ -41,6 +41,7 @@
 #include <linux/kernel_stat.h>
 #include <linux/mm.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
 #include <linux/sched/coredump.h>
 #include <linux/sched/numa_balancing.h>
 #include <linux/sched/task.h>
@@ -1023,12 +1024,303 @@ static int copy_pte_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 	return 0;
 }
 
+#ifdef CONFIG_LAZY_FORK_PGTABLES
+/*
+ * Lazy page table copying on fork.
+ *
+ * If the parent asked for it with PR_SET_LAZY_FORK, fork doesn't copy the
+ * pte tables of private anonymous mappings.  A table covering a whole pmd
+ * of such a vma is mapped by both parent and child instead, and both pmd
+ * entries are write-protected so that the hardware faults on writes
+ * through it.  ->pt_share_count of the table page is the number of mms
+ * mapping it, valid while the table is shared; the page count of the table
+ * is left alone, as pfn walkers may take temporary references to it.  The
+ * pages it maps are referenced once, on behalf of the table, but accounted
+ * to the rss of every mm using it.
+ *
+ * Any fault on a shared table, and anything else about to change its
+ * entries, copies it first with copy_one_pte(), just like fork would have
+ * done.  The last user of a table doesn't copy it, it makes its pmd
+ * writable again.  Unmapping a whole shared table just drops the reference
+ * to it.
+ *
+ * To keep this simple, tables with swap or migration entries are never
+ * shared, and reclaim and migration leave shared tables alone, so shared
+ * tables only ever contain none and present entries.  Changes to the
+ * sharing state of a table are serialized by its pte lock, which all of
+ * its users share, and within an mm by the pmd lock.  Shared tables never
+ * straddle vma boundaries, see unshare_partial_pte_tables(), so that they
+ * are either unmapped as a whole or not at all.
+ */
+static bool vma_lazy_fork(struct mm_struct *src_mm, struct vm_area_struct *vma)
+{
+	return USE_SPLIT_PTE_PTLOCKS &&
+	       test_bit(MMF_LAZY_FORK, &src_mm->flags) &&
+	       vma_is_anonymous(vma) && is_cow_mapping(vma->vm_flags) &&
+	       !(vma->vm_flags & (VM_UFFD_MISSING | VM_UFFD_WP));
+}
+
+/*
+ * Return the number of pages a pte table maps, or -1 if it contains swap or
+ * migration entries.  Only anonymous and zero pages are mapped here.
+ */
+static int pte_table_rss(pte_t *pte)
+{
+	int i, rss = 0;
+
+	for (i = 0; i < PTRS_PER_PTE; i++, pte++) {
+		pte_t ptent = *pte;
+
+		if (pte_none(ptent))
+			continue;
+		if (!pte_present(ptent))
+			return -1;
+		if (!pte_special(ptent))
+			rss++;
+	}
+	return rss;
+}
+
+/*
+ * Map the pte table @src_pmd points to into @dst_mm as well.  Return 0 if
+ * it has been shared, or -EBUSY if it has to be copied.
+ */
+static int share_pte_table(struct mm_struct *dst_mm, struct mm_struct *src_mm,
+			   pmd_t *dst_pmd, pmd_t *src_pmd, unsigned long addr)
+{
+	spinlock_t *ptl;
+	pte_t *pte;
+	int rss;
+
+	pte = pte_offset_map_lock(src_mm, src_pmd, addr, &ptl);
+	rss = pte_table_rss(pte);
+	if (rss >= 0) {
+		struct page *table = pmd_page(*src_pmd);
+
+		if (pmd_shared_pgtable(*src_pmd))
+			atomic_inc(&table->pt_share_count);
+		else
+			atomic_set(&table->pt_share_count, 2);
+		set_pmd(src_pmd, pmd_wrprotect(*src_pmd));
+		pmd_populate(dst_mm, dst_pmd, pmd_pgtable(*src_pmd));
+		set_pmd(dst_pmd, pmd_wrprotect(*dst_pmd));
+		atomic_long_inc(&dst_mm->nr_ptes);
+		add_mm_counter(dst_mm, MM_ANONPAGES, rss);
+	}
+	pte_unmap_unlock(pte, ptl);
+
+	return rss >= 0 ? 0 : -EBUSY;
+}
+
+/*
+ * Drop the reference of @vma's mm to the shared pte table @pmd points to,
+ * unless it is the last one.  Return true if it has been dropped.
+ */
+static bool pte_table_drop(struct vm_area_struct *vma, pmd_t *pmd,
+			   unsigned long addr)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	struct page *table;
+	spinlock_t *pml, *ptl;
+	bool dropped = false;
+	pte_t *pte;
+
+	pml = pmd_lock(mm, pmd);
+	if (!pmd_shared_pgtable(*pmd))
+		goto out;
+
+	table = pmd_page(*pmd);
+	pte = pte_offset_map(pmd, addr);
+	ptl = pte_lockptr(mm, pmd);
+	spin_lock_nested(ptl, SINGLE_DEPTH_NESTING);
+	if (atomic_read(&table->pt_share_count) > 1) {
+		add_mm_counter(mm, MM_ANONPAGES, -pte_table_rss(pte));
+		pmd_clear(pmd);
+		/* no stale walks of the table once the other users can free it */
+		flush_tlb_range(vma, addr, addr + PMD_SIZE);
+		atomic_dec(&table->pt_share_count);
+		atomic_long_dec(&mm->nr_ptes);
+		dropped = true;
+	}
+	spin_unlock(ptl);
+	pte_unmap(pte);
+out:
+	spin_unlock(pml);
+	return dropped;
+}
+
+/**
+ * pte_table_unshare - give @vma's mm a private copy of a shared pte table
+ * @vma: vma containing @addr
+ * @pmd: pmd entry for @addr
+ * @addr: address the table is needed for
+ *
+ * Must be called with mmap_sem held before the entries of a pte table which
+ * may have been shared on fork are changed.
+ *
+ * Return: 0 if the table is private now, -ENOMEM otherwise.
+ */
+int pte_table_unshare(struct vm_area_struct *vma, pmd_t *pmd,
+		      unsigned long addr)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long start = addr & PMD_MASK;
+	pte_t *src_pte, *dst_pte, *orig_src_pte, *orig_dst_pte;
+	int rss[NR_MM_COUNTERS];
+	spinlock_t *pml, *ptl;
+	struct page *table;
+	pgtable_t new;
+
+	if (likely(!pmd_shared_pgtable(*pmd)))
+		return 0;
+
+	new = pte_alloc_one(mm, start);
+	if (!new)
+		return -ENOMEM;
+
+	pml = pmd_lock(mm, pmd);
+	if (!pmd_shared_pgtable(*pmd))
+		goto out;
+
+	table = pmd_page(*pmd);
+	ptl = pte_lockptr(mm, pmd);
+	spin_lock_nested(ptl, SINGLE_DEPTH_NESTING);
+
+	if (atomic_read(&table->pt_share_count) == 1) {
+		/* the other users are gone, the table is ours again */
+		set_pmd(pmd, pmd_mkwrite(*pmd));
+		goto out_unlock;
+	}
+
+	/* the pages are accounted to @mm already, only copy the entries */
+	init_rss_vec(rss);
+	orig_src_pte = src_pte = pte_offset_map(pmd, start);
+	orig_dst_pte = dst_pte = kmap_atomic(new);
+	arch_enter_lazy_mmu_mode();
+
+	for (addr = start; addr != start + PMD_SIZE;
+	     addr += PAGE_SIZE, src_pte++, dst_pte++) {
+		if (pte_none(*src_pte))
+			continue;
+		WARN_ON_ONCE(copy_one_pte(mm, mm, dst_pte, src_pte, vma, addr,
+					  rss));
+	}
+
+	arch_leave_lazy_mmu_mode();
+	kunmap_atomic(orig_dst_pte);
+	pte_unmap(orig_src_pte);
+
+	smp_wmb(); /* See comment in __pte_alloc() */
+	pmd_populate(mm, pmd, new);
+	new = NULL;
+	flush_tlb_range(vma, start, start + PMD_SIZE);
+	atomic_dec(&table->pt_share_count);
+
+out_unlock:
+	spin_unlock(ptl);
+out:
+	spin_unlock(pml);
+	if (new)
+		pte_free(mm, new);
+	return 0;
+}
+
+/*
+ * Like pte_table_unshare(), for callers that can't fail: keep trying until
+ * the table has been copied, unless the task is about to die anyway.
+ */
+int pte_table_unshare_killable(struct vm_area_struct *vma, pmd_t *pmd,
+			       unsigned long addr)
+{
+	while (pte_table_unshare(vma, pmd, addr)) {
+		if (fatal_signal_pending(current))
+			return -EINTR;
+		schedule_timeout_uninterruptible(1);
+	}
+	return 0;
+}
+
+static int unshare_pte_table_at(struct mm_struct *mm, unsigned long addr)
+{
+	struct vm_area_struct *vma;
+	pgd_t *pgd;
+	p4d_t *p4d;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	if (!(addr & ~PMD_MASK))
+		return 0;
+
+	pgd = pgd_offset(mm, addr);
+	if (!pgd_present(*pgd))
+		return 0;
+	p4d = p4d_offset(pgd, addr);
+	if (!p4d_present(*p4d))
+		return 0;
+	pud = pud_offset(p4d, addr);
+	if (!pud_present(*pud) || pud_trans_huge(*pud))
+		return 0;
+	pmd = pmd_offset(pud, addr);
+	if (likely(!pmd_shared_pgtable(*pmd)))
+		return 0;
+
+	vma = find_vma(mm, addr);
+	if (WARN_ON_ONCE(!vma || vma->vm_start > addr))
+		return 0;
+
+	return pte_table_unshare(vma, pmd, addr);
+}
+
+/**
+ * unshare_partial_pte_tables - copy the shared pte tables across a boundary
+ * @mm: the mm
+ * @start: start of the range
+ * @end: end of the range
+ *
+ * Copy the shared pte tables that [@start, @end) covers only in part.  Must
+ * be called with mmap_sem held before a vma boundary is moved to @start or
+ * @end, so that shared tables always lie within a single vma.
+ *
+ * Return: 0 on success, -ENOMEM otherwise.
+ */
+int unshare_partial_pte_tables(struct mm_struct *mm, unsigned long start,
+			       unsigned long end)
+{
+	int err;
+
+	err = unshare_pte_table_at(mm, start);
+	if (!err)
+		err = unshare_pte_table_at(mm, end);
+	return err;
+}
+#else
+static inline bool vma_lazy_fork(struct mm_struct *src_mm,
+				 struct vm_area_struct *vma)
+{
+	return false;
+}
+
+static inline int share_pte_table(struct mm_struct *dst_mm,
+				  struct mm_struct *src_mm, pmd_t *dst_pmd,
+				  pmd_t *src_pmd, unsigned long addr)
+{
+	return -EBUSY;
+}
+
+static inline bool pte_table_drop(struct vm_area_struct *vma, pmd_t *pmd,
+				  unsigned long addr)
+{
+	return false;
+}
+#endif /* CONFIG_LAZY_FORK_PGTABLES */
+
 static inline int copy_pmd_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		pud_t *dst_pud, pud_t *src_pud, struct vm_area_struct *vma,
 		unsigned long addr, unsigned long end)
 {
 	pmd_t *src_pmd, *dst_pmd;
 	unsigned long next;
+	bool lazy = vma_lazy_fork(src_mm, vma);
 
 	dst_pmd = pmd_alloc(dst_mm, dst_pud, addr);
 	if (!dst_pmd)
@@ -1049,6 +1341,9 @@ static inline int copy_pmd_range(struct mm_struct *dst_mm, struct mm_struct *src
 		}
 		if (pmd_none_or_clear_bad(src_pmd))
 			continue;
+		if (lazy && next - addr == PMD_SIZE &&
+		    !share_pte_table(dst_mm, src_mm, dst_pmd, src_pmd, addr))
+			continue;
 		if (copy_pte_range(dst_mm, src_mm, dst_pmd, src_pmd,
 						vma, addr, next))
 			return -ENOMEM;
@@ -1314,6 +1609,15 @@ static inline unsigned long zap_pmd_range(struct mmu_gather *tlb,
 		 */
 		if (pmd_none_or_trans_huge_or_clear_bad(pmd))
 			goto next;
+		if (unlikely(pmd_shared_pgtable(*pmd))) {
+			/* drop whole shared tables, don't zap them */
+			if (next - addr == PMD_SIZE) {
+				if (pte_table_drop(vma, pmd, addr))
+					goto next;
+			} else if (pte_table_unshare_killable(vma, pmd, addr)) {
+				goto next;
+			}
+		}
 		next = zap_pte_range(tlb, vma, pmd, addr, next, details);
 next:
 		cond_resched();
@@ -3838,6 +4142,10 @@ static int __handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 		}
 	}
 
+	if (unlikely(pmd_shared_pgtable(*vmf.pmd)) &&
+	    pte_table_unshare(vma, vmf.pmd, address))
+		return VM_FAULT_OOM;
+
 	return handle_pte_fault(&vmf);
 }
 
@@ -677,6 +677,10 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
 	long adjust_next = 0;
 	int remove_next = 0;
 
+	/* pte tables shared on fork must not straddle the new boundaries */
+	if (unshare_partial_pte_tables(mm, start, end))
+		return -ENOMEM;
+
 	if (next && !insert) {
 		struct vm_area_struct *exporter = NULL, *importer = NULL;
 
@@ -179,6 +179,12 @@ static inline unsigned long change_pmd_range(struct vm_area_struct *vma,
 			}
 			/* fall through, the trans huge pmd just split */
 		}
+		if (unlikely(pmd_shared_pgtable(*pmd))) {
+			/* shared tables are write-protected already */
+			if (prot_numa ||
+			    pte_table_unshare_killable(vma, pmd, addr))
+				continue;
+		}
 		this_pages = change_pte_range(vma, pmd, addr, next, newprot,
 				 dirty_accountable, prot_numa);
 		pages += this_pages;
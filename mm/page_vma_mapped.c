@@ -156,6 +156,9 @@ bool page_vma_mapped_walk(struct page_vma_mapped_walk *pvmw)
 		if (!check_pmd(pvmw))
 			return false;
 	}
+	/* pte tables shared on fork can't be changed in place */
+	if (pmd_shared_pgtable(*pvmw->pmd))
+		return false;
 	if (!map_pte(pvmw))
 		goto next_pte;
 	while (1) {
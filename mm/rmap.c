@@ -711,6 +711,9 @@ pmd_t *mm_find_pmd(struct mm_struct *mm, unsigned long address)
 	barrier();
 	if (!pmd_present(pmde) || pmd_trans_huge(pmde))
 		pmd = NULL;
+	/* leave pte tables shared on fork alone until they are copied */
+	else if (pmd_shared_pgtable(pmde))
+		pmd = NULL;
 out:
 	return pmd;
 }
@@ -487,6 +487,11 @@ static __always_inline ssize_t __mcopy_atomic(struct mm_struct *dst_mm,
 		BUG_ON(pmd_none(*dst_pmd));
 		BUG_ON(pmd_trans_huge(*dst_pmd));
 
+		if (unlikely(pte_table_unshare(dst_vma, dst_pmd, dst_addr))) {
+			err = -ENOMEM;
+			break;
+		}
+
 		if (vma_is_anonymous(dst_vma)) {
 			if (!zeropage)
 				err = mcopy_atomic_pte(dst_mm, dst_pmd, dst_vma,
@@ -10,30 +10,138 @@
 #include <linux/etherdevice.h>
 #include <linux/filter.h>
 #include <linux/sched/signal.h>
+#include <linux/sched/task_stack.h>
+#include <linux/perf_event.h>
+#include <linux/trace_events.h>
+#include <uapi/linux/bpf_perf_event.h>
 
-static __always_inline u32 bpf_test_run_one(struct bpf_prog *prog, void *ctx)
+/* Per run latencies are kept in a log-linear histogram: values below
+ * BPF_TEST_HIST_SUB get a bucket each, above that every power of two is
+ * split into BPF_TEST_HIST_SUB buckets, so a bucket is never wider than
+ * 1/16 of the values it holds while all of u32 fits in 464 buckets.
+ */
+#define BPF_TEST_HIST_SUB_BITS	4
+#define BPF_TEST_HIST_SUB	(1U << BPF_TEST_HIST_SUB_BITS)
+#define BPF_TEST_HIST_BUCKETS	((32 - BPF_TEST_HIST_SUB_BITS + 1) * \
+				 BPF_TEST_HIST_SUB)
+
+/* max number of distinct frames in one batched XDP test run */
+#define BPF_TEST_BATCH_MAX	256
+
+struct bpf_test_stats {
+	u64 hist[BPF_TEST_HIST_BUCKETS];
+	u64 count;
+	u32 max;
+};
+
+static u32 bpf_test_hist_bucket(u32 val)
+{
+	u32 shift;
+
+	if (val < BPF_TEST_HIST_SUB)
+		return val;
+
+	shift = fls(val) - 1 - BPF_TEST_HIST_SUB_BITS;
+	return (shift + 1) * BPF_TEST_HIST_SUB +
+	       ((val >> shift) & (BPF_TEST_HIST_SUB - 1));
+}
+
+static u32 bpf_test_hist_upper(u32 bucket)
+{
+	u32 shift, sub;
+
+	if (bucket < BPF_TEST_HIST_SUB)
+		return bucket;
+
+	shift = bucket / BPF_TEST_HIST_SUB - 1;
+	sub = bucket % BPF_TEST_HIST_SUB;
+	return (((u64)(BPF_TEST_HIST_SUB + sub) << shift) +
+		(1ULL << shift) - 1);
+}
+
+static __always_inline void bpf_test_stats_add(struct bpf_test_stats *stats,
+					       u64 delta)
+{
+	u32 val = delta > U32_MAX ? U32_MAX : (u32)delta;
+
+	stats->hist[bpf_test_hist_bucket(val)]++;
+	stats->count++;
+	if (val > stats->max)
+		stats->max = val;
+}
+
+static u32 bpf_test_stats_pct(const struct bpf_test_stats *stats, u32 pct)
+{
+	u64 target, seen = 0;
+	u32 i;
+
+	target = div_u64(stats->count * pct + 99, 100);
+	for (i = 0; i < BPF_TEST_HIST_BUCKETS; i++) {
+		seen += stats->hist[i];
+		if (seen && seen >= target)
+			return min(bpf_test_hist_upper(i), stats->max);
+	}
+
+	return stats->max;
+}
+
+static struct bpf_test_stats *bpf_test_stats_alloc(const union bpf_attr *kattr)
+{
+	struct bpf_test_stats *stats;
+
+	if (kattr->test.flags & ~BPF_F_TEST_RUN_PERCENTILES)
+		return ERR_PTR(-EINVAL);
+	if (!(kattr->test.flags & BPF_F_TEST_RUN_PERCENTILES))
+		return NULL;
+
+	stats = kzalloc(sizeof(*stats), GFP_USER);
+	if (!stats)
+		return ERR_PTR(-ENOMEM);
+
+	return stats;
+}
+
+static __always_inline u32 bpf_test_run_one(struct bpf_prog *prog, void *ctx,
+					    struct bpf_test_stats *stats)
 {
+	u64 start = 0;
 	u32 ret;
 
 	preempt_disable();
+	/* keep programs attached to kprobes inside the helpers and maps
+	 * this program uses from running, as trace_call_bpf() does
+	 */
+	__this_cpu_inc(bpf_prog_active);
 	rcu_read_lock();
+	if (stats)
+		start = ktime_get_ns();
 	ret = BPF_PROG_RUN(prog, ctx);
+	if (stats)
+		bpf_test_stats_add(stats, ktime_get_ns() - start);
 	rcu_read_unlock();
+	__this_cpu_dec(bpf_prog_active);
 	preempt_enable();
 
 	return ret;
 }
 
-static u32 bpf_test_run(struct bpf_prog *prog, void *ctx, u32 repeat, u32 *time)
+/* Run the program 'repeat' times over each of the 'nr_ctx' contexts laid
+ * out 'ctx_size' bytes apart, and report the mean time of a single run.
+ */
+static u32 bpf_test_run(struct bpf_prog *prog, void *ctx, u32 nr_ctx,
+			size_t ctx_size, u32 repeat, u32 *time,
+			struct bpf_test_stats *stats)
 {
-	u64 time_start, time_spent = 0;
-	u32 ret = 0, i;
+	u64 time_start, time_spent = 0, runs = 0;
+	u32 ret = 0, i, j;
 
 	if (!repeat)
 		repeat = 1;
 	time_start = ktime_get_ns();
 	for (i = 0; i < repeat; i++) {
-		ret = bpf_test_run_one(prog, ctx);
+		for (j = 0; j < nr_ctx; j++)
+			ret = bpf_test_run_one(prog, ctx + j * ctx_size, stats);
+		runs += nr_ctx;
 		if (need_resched()) {
 			if (signal_pending(current))
 				break;
@@ -43,7 +151,7 @@ static u32 bpf_test_run(struct bpf_prog *prog, void *ctx, u32 repeat, u32 *time)
 		}
 	}
 	time_spent += ktime_get_ns() - time_start;
-	do_div(time_spent, repeat);
+	time_spent = div64_u64(time_spent, runs);
 	*time = time_spent > U32_MAX ? U32_MAX : (u32)time_spent;
 
 	return ret;
@@ -51,7 +159,8 @@ static u32 bpf_test_run(struct bpf_prog *prog, void *ctx, u32 repeat, u32 *time)
 
 static int bpf_test_finish(const union bpf_attr *kattr,
 			   union bpf_attr __user *uattr, const void *data,
-			   u32 size, u32 retval, u32 duration)
+			   u32 size, u32 retval, u32 duration,
+			   const struct bpf_test_stats *stats)
 {
 	void __user *data_out = u64_to_user_ptr(kattr->test.data_out);
 	int err = -EFAULT;
@@ -64,15 +173,28 @@ static int bpf_test_finish(const union bpf_attr *kattr,
 		goto out;
 	if (copy_to_user(&uattr->test.duration, &duration, sizeof(duration)))
 		goto out;
+	if (stats) {
+		u32 pct[4] = {
+			bpf_test_stats_pct(stats, 50),
+			bpf_test_stats_pct(stats, 90),
+			bpf_test_stats_pct(stats, 99),
+			stats->max,
+		};
+
+		BUILD_BUG_ON(offsetof(union bpf_attr, test.duration_max) -
+			     offsetof(union bpf_attr, test.duration_p50) !=
+			     sizeof(pct) - sizeof(pct[0]));
+		if (copy_to_user(&uattr->test.duration_p50, pct, sizeof(pct)))
+			goto out;
+	}
 	err = 0;
 out:
 	return err;
 }
 
-static void *bpf_test_init(const union bpf_attr *kattr, u32 size,
+static void *bpf_test_init(void __user *data_in, u32 size,
 			   u32 headroom, u32 tailroom)
 {
-	void __user *data_in = u64_to_user_ptr(kattr->test.data_in);
 	void *data;
 
 	if (size < ETH_HLEN || size > PAGE_SIZE - headroom - tailroom)
@@ -95,15 +217,27 @@ int bpf_prog_test_run_skb(struct bpf_prog *prog, const union bpf_attr *kattr,
 	bool is_l2 = false, is_direct_pkt_access = false;
 	u32 size = kattr->test.data_size_in;
 	u32 repeat = kattr->test.repeat;
+	struct bpf_test_stats *stats;
 	u32 retval, duration;
 	struct sk_buff *skb;
 	void *data;
 	int ret;
 
-	data = bpf_test_init(kattr, size, NET_SKB_PAD + NET_IP_ALIGN,
+	if (kattr->test.ctx_in || kattr->test.ctx_size_in ||
+	    kattr->test.batch_size)
+		return -EINVAL;
+
+	stats = bpf_test_stats_alloc(kattr);
+	if (IS_ERR(stats))
+		return PTR_ERR(stats);
+
+	data = bpf_test_init(u64_to_user_ptr(kattr->test.data_in), size,
+			     NET_SKB_PAD + NET_IP_ALIGN,
 			     SKB_DATA_ALIGN(sizeof(struct skb_shared_info)));
-	if (IS_ERR(data))
+	if (IS_ERR(data)) {
+		kfree(stats);
 		return PTR_ERR(data);
+	}
 
 	switch (prog->type) {
 	case BPF_PROG_TYPE_SCHED_CLS:
@@ -122,6 +256,7 @@ int bpf_prog_test_run_skb(struct bpf_prog *prog, const union bpf_attr *kattr,
 	skb = build_skb(data, 0);
 	if (!skb) {
 		kfree(data);
+		kfree(stats);
 		return -ENOMEM;
 	}
 
@@ -134,15 +269,88 @@ int bpf_prog_test_run_skb(struct bpf_prog *prog, const union bpf_attr *kattr,
 		__skb_push(skb, ETH_HLEN);
 	if (is_direct_pkt_access)
 		bpf_compute_data_end(skb);
-	retval = bpf_test_run(prog, skb, repeat, &duration);
+	retval = bpf_test_run(prog, skb, 1, 0, repeat, &duration, stats);
 	if (!is_l2)
 		__skb_push(skb, ETH_HLEN);
 	size = skb->len;
 	/* bpf program can never convert linear skb to non-linear */
 	if (WARN_ON_ONCE(skb_is_nonlinear(skb)))
 		size = skb_headlen(skb);
-	ret = bpf_test_finish(kattr, uattr, skb->data, size, retval, duration);
+	ret = bpf_test_finish(kattr, uattr, skb->data, size, retval, duration,
+			      stats);
 	kfree_skb(skb);
+	kfree(stats);
+	return ret;
+}
+
+/* data_in holds test.batch_size frames back to back, with the length of
+ * each one in the test.batch_lens array. Every frame gets a buffer of its
+ * own, so the program sees the cache and branch behaviour of a stream of
+ * distinct packets instead of the same one over and over. The output is
+ * the last frame after the last run.
+ */
+static int bpf_prog_test_run_xdp_batch(struct bpf_prog *prog,
+				       const union bpf_attr *kattr,
+				       union bpf_attr __user *uattr,
+				       struct bpf_test_stats *stats)
+{
+	void __user *lens_in = u64_to_user_ptr(kattr->test.batch_lens);
+	void __user *data_in = u64_to_user_ptr(kattr->test.data_in);
+	u32 headroom = XDP_PACKET_HEADROOM + NET_IP_ALIGN;
+	u32 size_in = kattr->test.data_size_in;
+	u32 nr = kattr->test.batch_size;
+	u32 retval, duration, off = 0;
+	struct xdp_buff *xdp, *last;
+	u32 *lens;
+	int i, ret;
+
+	if (nr > BPF_TEST_BATCH_MAX)
+		return -E2BIG;
+
+	lens = kcalloc(nr, sizeof(*lens), GFP_USER);
+	xdp = kcalloc(nr, sizeof(*xdp), GFP_USER);
+	ret = -ENOMEM;
+	if (!lens || !xdp)
+		goto out;
+
+	ret = -EFAULT;
+	if (copy_from_user(lens, lens_in, nr * sizeof(*lens)))
+		goto out;
+
+	for (i = 0; i < nr; i++) {
+		void *data;
+
+		ret = -EINVAL;
+		if (lens[i] > size_in - off)
+			goto out;
+
+		data = bpf_test_init(data_in + off, lens[i], headroom, 0);
+		if (IS_ERR(data)) {
+			ret = PTR_ERR(data);
+			goto out;
+		}
+		off += lens[i];
+
+		xdp[i].data_hard_start = data;
+		xdp[i].data = data + headroom;
+		xdp[i].data_end = xdp[i].data + lens[i];
+	}
+
+	ret = -EINVAL;
+	if (off != size_in)
+		goto out;
+
+	retval = bpf_test_run(prog, xdp, nr, sizeof(*xdp), kattr->test.repeat,
+			      &duration, stats);
+	last = &xdp[nr - 1];
+	ret = bpf_test_finish(kattr, uattr, last->data,
+			      last->data_end - last->data, retval, duration,
+			      stats);
+out:
+	for (i = 0; xdp && i < nr; i++)
+		kfree(xdp[i].data_hard_start);
+	kfree(xdp);
+	kfree(lens);
 	return ret;
 }
 
@@ -151,23 +359,150 @@ int bpf_prog_test_run_xdp(struct bpf_prog *prog, const union bpf_attr *kattr,
 {
 	u32 size = kattr->test.data_size_in;
 	u32 repeat = kattr->test.repeat;
+	struct bpf_test_stats *stats;
 	struct xdp_buff xdp = {};
 	u32 retval, duration;
 	void *data;
 	int ret;
 
-	data = bpf_test_init(kattr, size, XDP_PACKET_HEADROOM + NET_IP_ALIGN, 0);
-	if (IS_ERR(data))
+	if (kattr->test.ctx_in || kattr->test.ctx_size_in)
+		return -EINVAL;
+
+	stats = bpf_test_stats_alloc(kattr);
+	if (IS_ERR(stats))
+		return PTR_ERR(stats);
+
+	if (kattr->test.batch_size) {
+		ret = bpf_prog_test_run_xdp_batch(prog, kattr, uattr, stats);
+		kfree(stats);
+		return ret;
+	}
+
+	data = bpf_test_init(u64_to_user_ptr(kattr->test.data_in), size,
+			     XDP_PACKET_HEADROOM + NET_IP_ALIGN, 0);
+	if (IS_ERR(data)) {
+		kfree(stats);
 		return PTR_ERR(data);
+	}
 
 	xdp.data_hard_start = data;
 	xdp.data = data + XDP_PACKET_HEADROOM + NET_IP_ALIGN;
 	xdp.data_end = xdp.data + size;
 
-	retval = bpf_test_run(prog, &xdp, repeat, &duration);
+	retval = bpf_test_run(prog, &xdp, 1, 0, repeat, &duration, stats);
 	if (xdp.data != data + XDP_PACKET_HEADROOM + NET_IP_ALIGN)
 		size = xdp.data_end - xdp.data;
-	ret = bpf_test_finish(kattr, uattr, xdp.data, size, retval, duration);
+	ret = bpf_test_finish(kattr, uattr, xdp.data, size, retval, duration,
+			      stats);
 	kfree(data);
+	kfree(stats);
+	return ret;
+}
+
+#ifdef CONFIG_BPF_EVENTS
+/* Tracing programs take no packet, only a context that the caller passes
+ * in ctx_in. Bytes past ctx_size_in, up to the full context, read as zero.
+ */
+static void *bpf_test_ctx_init(const union bpf_attr *kattr, u32 max_size)
+{
+	void __user *ctx_in = u64_to_user_ptr(kattr->test.ctx_in);
+	u32 size = kattr->test.ctx_size_in;
+	void *ctx;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return ERR_PTR(-EPERM);
+
+	if (kattr->test.data_in || kattr->test.data_size_in ||
+	    kattr->test.data_out || kattr->test.batch_size ||
+	    size > max_size)
+		return ERR_PTR(-EINVAL);
+
+	ctx = kzalloc(max_size, GFP_USER);
+	if (!ctx)
+		return ERR_PTR(-ENOMEM);
+
+	if (copy_from_user(ctx, ctx_in, size)) {
+		kfree(ctx);
+		return ERR_PTR(-EFAULT);
+	}
+	return ctx;
+}
+
+static int bpf_test_run_ctx(struct bpf_prog *prog, const union bpf_attr *kattr,
+			    union bpf_attr __user *uattr, void *ctx)
+{
+	struct bpf_test_stats *stats;
+	u32 retval, duration;
+	int ret;
+
+	stats = bpf_test_stats_alloc(kattr);
+	if (IS_ERR(stats))
+		return PTR_ERR(stats);
+
+	retval = bpf_test_run(prog, ctx, 1, 0, kattr->test.repeat, &duration,
+			      stats);
+	ret = bpf_test_finish(kattr, uattr, NULL, 0, retval, duration, stats);
+	kfree(stats);
+	return ret;
+}
+
+int bpf_prog_test_run_kprobe(struct bpf_prog *prog,
+			     const union bpf_attr *kattr,
+			     union bpf_attr __user *uattr)
+{
+	struct pt_regs *regs;
+	int ret;
+
+	regs = bpf_test_ctx_init(kattr, sizeof(*regs));
+	if (IS_ERR(regs))
+		return PTR_ERR(regs);
+
+	ret = bpf_test_run_ctx(prog, kattr, uattr, regs);
+	kfree(regs);
+	return ret;
+}
+
+int bpf_prog_test_run_tracepoint(struct bpf_prog *prog,
+				 const union bpf_attr *kattr,
+				 union bpf_attr __user *uattr)
+{
+	void *buff;
+	int ret;
+
+	buff = bpf_test_ctx_init(kattr, PERF_MAX_TRACE_SIZE);
+	if (IS_ERR(buff))
+		return PTR_ERR(buff);
+
+	/* the first 8 bytes of the record are hidden from the program and
+	 * point to the registers of the event, the helpers that need them
+	 * get the ones the calling task entered the kernel with.
+	 */
+	*(struct pt_regs **)buff = task_pt_regs(current);
+
+	ret = bpf_test_run_ctx(prog, kattr, uattr, buff);
+	kfree(buff);
+	return ret;
+}
+
+int bpf_prog_test_run_perf_event(struct bpf_prog *prog,
+				 const union bpf_attr *kattr,
+				 union bpf_attr __user *uattr)
+{
+	struct bpf_perf_event_data_kern real_ctx;
+	struct bpf_perf_event_data *ctx;
+	struct perf_sample_data data;
+	int ret;
+
+	ctx = bpf_test_ctx_init(kattr, sizeof(*ctx));
+	if (IS_ERR(ctx))
+		return PTR_ERR(ctx);
+
+	perf_sample_data_init(&data, 0, ctx->sample_period);
+	real_ctx.regs = &ctx->regs;
+	real_ctx.data = &data;
+
+	ret = bpf_test_run_ctx(prog, kattr, uattr, &real_ctx);
+	kfree(ctx);
 	return ret;
 }
+#endif /* CONFIG_BPF_EVENTS */
@@ -35,11 +35,16 @@ int bpf_load_program(enum bpf_prog_type type, const struct bpf_insn *insns,
 		     size_t insns_cnt, const char *license,
 		     __u32 kern_version, char *log_buf,
 		     size_t log_buf_sz);
+/* Like bpf_load_program(), but always fetches the verifier log */
+int bpf_verify_program(enum bpf_prog_type type, const struct bpf_insn *insns,
+		       size_t insns_cnt, const char *license,
+		       __u32 kern_version, char *log_buf, size_t log_buf_sz);
 
 int bpf_map_update_elem(int fd, const void *key, const void *value,
 			__u64 flags);
 
 int bpf_map_lookup_elem(int fd, const void *key, void *value);
+int bpf_map_lookup_and_delete_elem(int fd, const void *key, void *value);
 int bpf_map_delete_elem(int fd, const void *key);
 int bpf_map_get_next_key(int fd, const void *key, void *next_key);
 int bpf_obj_pin(int fd, const char *pathname);
@@ -51,4 +56,26 @@ int bpf_prog_test_run(int prog_fd, int repeat, void *data, __u32 size,
 		      void *data_out, __u32 *size_out, __u32 *retval,
 		      __u32 *duration);
 
+struct bpf_prog_test_run_attr {
+	int prog_fd;
+	int repeat;
+	__u32 flags;		/* BPF_F_TEST_RUN_* */
+	const void *data_in;
+	__u32 data_size_in;
+	void *data_out;		/* optional */
+	__u32 data_size_out;	/* out */
+	const void *ctx_in;	/* optional, tracing programs */
+	__u32 ctx_size_in;
+	const __u32 *batch_lens; /* optional, XDP frame lengths */
+	__u32 batch_size;
+	__u32 retval;		/* out */
+	__u32 duration;		/* out, mean of one run */
+	__u32 duration_p50;	/* out, with BPF_F_TEST_RUN_PERCENTILES */
+	__u32 duration_p90;
+	__u32 duration_p99;
+	__u32 duration_max;
+};
+
+int bpf_prog_test_run_xattr(struct bpf_prog_test_run_attr *test_attr);
+
 #endif
@@ -156,7 +156,7 @@ static void test_lpm_order(void)
 	tlpm_clear(l2);
 }
 
-static void test_lpm_map(int keysize)
+static void test_lpm_map(int keysize, int max_entries)
 {
 	size_t i, j, n_matches, n_nodes, n_lookups;
 	struct tlpm_node *t, *list = NULL;
@@ -185,7 +185,7 @@ static void test_lpm_map(int keysize)
 	map = bpf_create_map(BPF_MAP_TYPE_LPM_TRIE,
 			     sizeof(*key) + keysize,
 			     keysize + 1,
-			     4096,
+			     max_entries,
 			     BPF_F_NO_PREALLOC);
 	assert(map >= 0);
 
@@ -347,9 +347,13 @@ int main(void)
 	test_lpm_basic();
 	test_lpm_order();
 
-	/* Test with 8, 16, 24, 32, ... 128 bit prefix length */
-	for (i = 1; i <= 16; ++i)
-		test_lpm_map(i);
+	/* Test with 8, 16, 24, 32, ... 128 bit prefix length, and with maps
+	 * large enough for their stride table to cover up to 16 bits.
+	 */
+	for (i = 1; i <= 16; ++i) {
+		test_lpm_map(i, 4096);
+		test_lpm_map(i, 1 << 16);
+	}
 
 	test_lpm_ipaddr();
 
@@ -294,6 +294,121 @@ static void test_arraymap(int task, void *data)
 	close(fd);
 }
 
+#define QUEUE_STACK_SIZE 32
+
+static void test_queuemap(int task, void *data)
+{
+	__u32 vals[QUEUE_STACK_SIZE + QUEUE_STACK_SIZE / 2], val;
+	int fd, i;
+
+	for (i = 0; i < QUEUE_STACK_SIZE + QUEUE_STACK_SIZE / 2; i++)
+		vals[i] = rand();
+
+	/* Invalid key size */
+	fd = bpf_create_map(BPF_MAP_TYPE_QUEUE, 4, sizeof(val),
+			    QUEUE_STACK_SIZE, 0);
+	assert(fd < 0 && errno == EINVAL);
+
+	fd = bpf_create_map(BPF_MAP_TYPE_QUEUE, 0, sizeof(val),
+			    QUEUE_STACK_SIZE, 0);
+	if (fd < 0) {
+		printf("Failed to create queuemap '%s'!\n", strerror(errno));
+		exit(1);
+	}
+
+	/* Empty queue */
+	assert(bpf_map_lookup_elem(fd, NULL, &val) == -1 && errno == ENOENT);
+	assert(bpf_map_lookup_and_delete_elem(fd, NULL, &val) == -1 &&
+	       errno == ENOENT);
+
+	/* Push elements into the queue */
+	for (i = 0; i < QUEUE_STACK_SIZE; i++)
+		assert(bpf_map_update_elem(fd, NULL, &vals[i], 0) == 0);
+
+	/* Check that element cannot be pushed due to max_entries limit */
+	assert(bpf_map_update_elem(fd, NULL, &val, 0) == -1 &&
+	       errno == E2BIG);
+
+	/* Peek element */
+	assert(bpf_map_lookup_elem(fd, NULL, &val) == 0 && val == vals[0]);
+
+	/* Replace half elements, oldest ones go first */
+	for (i = QUEUE_STACK_SIZE; i < QUEUE_STACK_SIZE + QUEUE_STACK_SIZE / 2; i++)
+		assert(bpf_map_update_elem(fd, NULL, &vals[i], BPF_EXIST) == 0);
+
+	/* Pop all elements in FIFO order */
+	for (i = QUEUE_STACK_SIZE / 2; i < QUEUE_STACK_SIZE + QUEUE_STACK_SIZE / 2; i++)
+		assert(bpf_map_lookup_and_delete_elem(fd, NULL, &val) == 0 &&
+		       val == vals[i]);
+
+	/* Queue is empty again */
+	assert(bpf_map_lookup_and_delete_elem(fd, NULL, &val) == -1 &&
+	       errno == ENOENT);
+
+	/* Key based operations are not supported */
+	assert(bpf_map_delete_elem(fd, NULL) == -1 && errno == EINVAL);
+	assert(bpf_map_get_next_key(fd, NULL, NULL) == -1 && errno == EINVAL);
+
+	close(fd);
+}
+
+static void test_stackmap(int task, void *data)
+{
+	__u32 vals[QUEUE_STACK_SIZE + QUEUE_STACK_SIZE / 2], val;
+	int fd, i;
+
+	for (i = 0; i < QUEUE_STACK_SIZE + QUEUE_STACK_SIZE / 2; i++)
+		vals[i] = rand();
+
+	/* Invalid key size */
+	fd = bpf_create_map(BPF_MAP_TYPE_STACK, 4, sizeof(val),
+			    QUEUE_STACK_SIZE, 0);
+	assert(fd < 0 && errno == EINVAL);
+
+	fd = bpf_create_map(BPF_MAP_TYPE_STACK, 0, sizeof(val),
+			    QUEUE_STACK_SIZE, 0);
+	if (fd < 0) {
+		printf("Failed to create stackmap '%s'!\n", strerror(errno));
+		exit(1);
+	}
+
+	/* Empty stack */
+	assert(bpf_map_lookup_elem(fd, NULL, &val) == -1 && errno == ENOENT);
+	assert(bpf_map_lookup_and_delete_elem(fd, NULL, &val) == -1 &&
+	       errno == ENOENT);
+
+	/* Push elements onto the stack */
+	for (i = 0; i < QUEUE_STACK_SIZE; i++)
+		assert(bpf_map_update_elem(fd, NULL, &vals[i], 0) == 0);
+
+	/* Check that element cannot be pushed due to max_entries limit */
+	assert(bpf_map_update_elem(fd, NULL, &val, 0) == -1 &&
+	       errno == E2BIG);
+
+	/* Peek element */
+	assert(bpf_map_lookup_elem(fd, NULL, &val) == 0 &&
+	       val == vals[QUEUE_STACK_SIZE - 1]);
+
+	/* Replace half elements, the bottom of the stack goes first */
+	for (i = QUEUE_STACK_SIZE; i < QUEUE_STACK_SIZE + QUEUE_STACK_SIZE / 2; i++)
+		assert(bpf_map_update_elem(fd, NULL, &vals[i], BPF_EXIST) == 0);
+
+	/* Pop all elements in LIFO order */
+	for (i = QUEUE_STACK_SIZE + QUEUE_STACK_SIZE / 2 - 1; i >= QUEUE_STACK_SIZE / 2; i--)
+		assert(bpf_map_lookup_and_delete_elem(fd, NULL, &val) == 0 &&
+		       val == vals[i]);
+
+	/* Stack is empty again */
+	assert(bpf_map_lookup_and_delete_elem(fd, NULL, &val) == -1 &&
+	       errno == ENOENT);
+
+	/* Key based operations are not supported */
+	assert(bpf_map_delete_elem(fd, NULL) == -1 && errno == EINVAL);
+	assert(bpf_map_get_next_key(fd, NULL, NULL) == -1 && errno == EINVAL);
+
+	close(fd);
+}
+
 static void test_arraymap_percpu(int task, void *data)
 {
 	unsigned int nr_cpus = bpf_num_possible_cpus();
@@ -555,6 +670,9 @@ static void run_all_tests(void)
 
 	test_arraymap_percpu_many_keys();
 
+	test_queuemap(0, NULL);
+	test_stackmap(0, NULL);
+
 	test_map_large();
 	test_map_parallel();
 	test_map_stress();
@@ -572,6 +690,15 @@ int main(void)
 	map_flags = BPF_F_NO_PREALLOC;
 	run_all_tests();
 
+	/* Resizing only applies to hash maps, and has them grow from
+	 * the minimum size all the way up in the large and parallel tests.
+	 */
+	map_flags = BPF_F_NO_PREALLOC | BPF_F_RESIZABLE;
+	test_hashmap(0, NULL);
+	test_hashmap_percpu(0, NULL);
+	test_map_large();
+	test_map_parallel();
+
 	printf("test_maps: OK\n");
 	return 0;
 }
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <linux/types.h>
 typedef __u16 __sum16;
@@ -25,6 +26,8 @@ typedef __u16 __sum16;
 
 #include <linux/bpf.h>
 #include <linux/err.h>
+#include <linux/filter.h>
+#include <linux/version.h>
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 #include "test_iptunnel_common.h"
@@ -190,6 +193,108 @@ static void test_xdp(void)
 #define NUM_ITER 100000
 #define VIP_NUM 5
 
+static void test_xdp_batch(void)
+{
+	struct vip key4 = {.protocol = 6, .family = AF_INET};
+	struct vip key6 = {.protocol = 6, .family = AF_INET6};
+	struct iptnl_info value4 = {.family = AF_INET};
+	struct iptnl_info value6 = {.family = AF_INET6};
+	const char *file = "./test_xdp.o";
+	struct bpf_prog_test_run_attr tattr = {};
+	char pkts[2 * sizeof(pkt_v4) + sizeof(pkt_v6)];
+	__u32 lens[3] = { sizeof(pkt_v4), sizeof(pkt_v6), sizeof(pkt_v4) };
+	struct bpf_object *obj;
+	char buf[128];
+	struct iphdr *iph = (void *)buf + sizeof(struct ethhdr);
+	__u32 duration;
+	int err, prog_fd, map_fd;
+
+	err = bpf_prog_load(file, BPF_PROG_TYPE_XDP, &obj, &prog_fd);
+	if (err)
+		return;
+
+	map_fd = bpf_find_map(__func__, obj, "vip2tnl");
+	if (map_fd < 0)
+		goto out;
+	bpf_map_update_elem(map_fd, &key4, &value4, 0);
+	bpf_map_update_elem(map_fd, &key6, &value6, 0);
+
+	memcpy(pkts, &pkt_v4, sizeof(pkt_v4));
+	memcpy(pkts + sizeof(pkt_v4), &pkt_v6, sizeof(pkt_v6));
+	memcpy(pkts + sizeof(pkt_v4) + sizeof(pkt_v6), &pkt_v4,
+	       sizeof(pkt_v4));
+
+	tattr.prog_fd = prog_fd;
+	tattr.repeat = 1;
+	tattr.flags = BPF_F_TEST_RUN_PERCENTILES;
+	tattr.data_in = pkts;
+	tattr.data_size_in = sizeof(pkts);
+	tattr.data_out = buf;
+	tattr.batch_lens = lens;
+	tattr.batch_size = 3;
+
+	/* output is the last frame of the batch */
+	err = bpf_prog_test_run_xattr(&tattr);
+	duration = tattr.duration;
+	CHECK(err || errno || tattr.retval != XDP_TX ||
+	      tattr.data_size_out != 74 || iph->protocol != IPPROTO_IPIP,
+	      "batch", "err %d errno %d retval %d size %d\n",
+	      err, errno, tattr.retval, tattr.data_size_out);
+
+	CHECK(tattr.duration_p50 > tattr.duration_p90 ||
+	      tattr.duration_p90 > tattr.duration_p99 ||
+	      tattr.duration_p99 > tattr.duration_max ||
+	      !tattr.duration_max, "percentiles",
+	      "p50 %u p90 %u p99 %u max %u\n", tattr.duration_p50,
+	      tattr.duration_p90, tattr.duration_p99, tattr.duration_max);
+
+	/* frame lengths have to add up to data_size_in */
+	lens[2] = sizeof(pkt_v4) - 1;
+	err = bpf_prog_test_run_xattr(&tattr);
+	CHECK(err != -1 || errno != EINVAL, "batch_lens",
+	      "err %d errno %d\n", err, errno);
+out:
+	bpf_object__close(obj);
+}
+
+static void test_kprobe_ctx(void)
+{
+	struct bpf_insn prog[] = {
+		BPF_LDX_MEM(BPF_DW, BPF_REG_0, BPF_REG_1, 0),
+		BPF_EXIT_INSN(),
+	};
+	struct bpf_prog_test_run_attr tattr = {};
+	__u64 ctx = 0x12345678;
+	__u32 duration = 0;
+	int prog_fd, err;
+
+	prog_fd = bpf_load_program(BPF_PROG_TYPE_KPROBE, prog,
+				   sizeof(prog) / sizeof(prog[0]), "GPL",
+				   LINUX_VERSION_CODE, NULL, 0);
+	CHECK(prog_fd < 0, "load", "errno %d\n", errno);
+	if (prog_fd < 0)
+		return;
+
+	/* the rest of pt_regs is zero filled */
+	tattr.prog_fd = prog_fd;
+	tattr.repeat = 10;
+	tattr.ctx_in = &ctx;
+	tattr.ctx_size_in = sizeof(ctx);
+	err = bpf_prog_test_run_xattr(&tattr);
+	duration = tattr.duration;
+	CHECK(err || tattr.retval != ctx, "ctx",
+	      "err %d errno %d retval %x\n", err, errno, tattr.retval);
+
+	/* packet data does not apply to tracing programs */
+	tattr.data_in = &pkt_v4;
+	tattr.data_size_in = sizeof(pkt_v4);
+	err = bpf_prog_test_run_xattr(&tattr);
+	CHECK(err != -1 || errno != EINVAL, "data_in",
+	      "err %d errno %d\n", err, errno);
+
+	close(prog_fd);
+}
+
 static void test_l4lb(void)
 {
 	unsigned int nr_cpus = bpf_num_possible_cpus();
@@ -268,6 +373,118 @@ static void test_l4lb(void)
 	bpf_object__close(obj);
 }
 
+#define VERIFIER_LOG_SIZE	(1 << 23)
+#define VERIFIER_LOADS		10
+
+static char verifier_log[VERIFIER_LOG_SIZE];
+
+struct verifier_stats {
+	enum bpf_prog_type type;
+	int insn_processed;
+	__u64 nsec;
+	int err;
+};
+
+static __u64 time_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Runs on the relocated instructions, so the program can be loaded
+ * directly and libbpf does not have to load it again.
+ */
+static int verifier_stats_prep(struct bpf_program *prog, int n,
+			       struct bpf_insn *insns, int insns_cnt,
+			       struct bpf_prog_prep_result *res)
+{
+	struct verifier_stats *st = bpf_program__priv(prog);
+	const char *line;
+	__u64 start;
+	int i, fd;
+
+	start = time_get_ns();
+	for (i = 0; i < VERIFIER_LOADS; i++) {
+		fd = bpf_load_program(st->type, insns, insns_cnt, "GPL", 0,
+				      NULL, 0);
+		if (fd < 0) {
+			st->err = -errno;
+			return 0;
+		}
+		close(fd);
+	}
+	st->nsec = (time_get_ns() - start) / VERIFIER_LOADS;
+
+	fd = bpf_verify_program(st->type, insns, insns_cnt, "GPL", 0,
+				verifier_log, sizeof(verifier_log));
+	if (fd < 0) {
+		st->err = -errno;
+		return 0;
+	}
+	close(fd);
+
+	line = strstr(verifier_log, "processed ");
+	if (!line || sscanf(line, "processed %d insns",
+			    &st->insn_processed) != 1)
+		st->err = -EINVAL;
+	return 0;
+}
+
+/* Not a functional test: reports how many instructions the verifier walks
+ * and how long it takes to load each of the programs above, to keep an
+ * eye on the cost of verifying larger programs.
+ */
+static void test_verifier_stats(void)
+{
+	static const struct {
+		const char *file;
+		enum bpf_prog_type type;
+	} progs[] = {
+		{ "./test_pkt_access.o", BPF_PROG_TYPE_SCHED_CLS },
+		{ "./test_xdp.o", BPF_PROG_TYPE_XDP },
+		{ "./test_l4lb.o", BPF_PROG_TYPE_SCHED_CLS },
+	};
+	struct verifier_stats st;
+	struct bpf_program *prog;
+	struct bpf_object *obj;
+	__u32 duration;
+	int i, err;
+
+	for (i = 0; i < sizeof(progs) / sizeof(progs[0]); i++) {
+		memset(&st, 0, sizeof(st));
+		st.type = progs[i].type;
+
+		obj = bpf_object__open(progs[i].file);
+		if (IS_ERR(obj)) {
+			error_cnt++;
+			continue;
+		}
+
+		prog = bpf_program__next(NULL, obj);
+		if (!prog) {
+			bpf_object__close(obj);
+			error_cnt++;
+			continue;
+		}
+
+		bpf_program__set_type(prog, st.type);
+		bpf_program__set_priv(prog, &st, NULL);
+		bpf_program__set_prep(prog, 1, verifier_stats_prep);
+
+		err = bpf_object__load(obj);
+		duration = st.nsec;
+		CHECK(err || st.err, progs[i].file,
+		      "err %d verifier err %d\n", err, st.err);
+		if (!err && !st.err)
+			printf("%s: processed %d insns, %llu usec to verify\n",
+			       progs[i].file, st.insn_processed,
+			       (unsigned long long)st.nsec / 1000);
+		bpf_object__close(obj);
+	}
+}
+
 int main(void)
 {
 	struct rlimit rinf = { RLIM_INFINITY, RLIM_INFINITY };
@@ -276,7 +493,10 @@ int main(void)
 
 	test_pkt_access();
 	test_xdp();
+	test_xdp_batch();
+	test_kprobe_ctx();
 	test_l4lb();
+	test_verifier_stats();
 
 	printf("Summary: %d PASSED, %d FAILED\n", pass_cnt, error_cnt);
 	return 0;
@@ -0,0 +1,117 @@
+/******************************************************************************
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ * DESCRIPTION
+ *      Test PR_SET_FUTEX_HASH/PR_GET_FUTEX_HASH and that private futexes
+ *      still wait and wake across threads on a process private hash.
+ *
+ *****************************************************************************/
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include "futextest.h"
+#include "logging.h"
+
+#ifndef PR_SET_FUTEX_HASH
+#define PR_SET_FUTEX_HASH	48
+#define PR_GET_FUTEX_HASH	49
+#endif
+
+#define NR_FUTEXES	64
+
+static futex_t futexes[NR_FUTEXES];
+
+void usage(char *prog)
+{
+	printf("Usage: %s\n", prog);
+	printf("  -c	Use color\n");
+	printf("  -h	Display this help message\n");
+	printf("  -v L	Verbosity level: %d=QUIET %d=CRITICAL %d=INFO\n",
+	       VQUIET, VCRITICAL, VINFO);
+}
+
+void *waiterfn(void *arg)
+{
+	futex_t *f = arg;
+
+	while (*f == 0)
+		futex_wait(f, 0, NULL, FUTEX_PRIVATE_FLAG);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t waiters[NR_FUTEXES];
+	int res, ret = RET_PASS;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "chv:")) != -1) {
+		switch (c) {
+		case 'c':
+			log_color(1);
+			break;
+		case 'h':
+			usage(basename(argv[0]));
+			exit(0);
+		case 'v':
+			log_verbosity(atoi(optarg));
+			break;
+		default:
+			usage(basename(argv[0]));
+			exit(1);
+		}
+	}
+
+	printf("%s: Test private futexes on a process private hash\n",
+	       basename(argv[0]));
+
+	res = prctl(PR_SET_FUTEX_HASH, 100, 0, 0, 0);
+	if (res) {
+		fail("PR_SET_FUTEX_HASH returned: %d %s\n", errno,
+		     strerror(errno));
+		ret = RET_FAIL;
+		goto out;
+	}
+
+	res = prctl(PR_GET_FUTEX_HASH, 0, 0, 0, 0);
+	if (res != 128) {
+		fail("PR_GET_FUTEX_HASH returned %d, expected 128\n", res);
+		ret = RET_FAIL;
+	}
+
+	res = prctl(PR_SET_FUTEX_HASH, 256, 0, 0, 0);
+	if (!res || errno != EBUSY) {
+		fail("second PR_SET_FUTEX_HASH returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		ret = RET_FAIL;
+	}
+
+	for (i = 0; i < NR_FUTEXES; i++) {
+		if (pthread_create(&waiters[i], NULL, waiterfn,
+				   (void *)&futexes[i])) {
+			error("pthread_create failed\n", errno);
+			ret = RET_ERROR;
+			goto out;
+		}
+	}
+
+	info("Waking %d waiters\n", NR_FUTEXES);
+	for (i = 0; i < NR_FUTEXES; i++) {
+		futexes[i] = 1;
+		futex_wake(&futexes[i], 1, FUTEX_PRIVATE_FLAG);
+		pthread_join(waiters[i], NULL);
+	}
+
+out:
+	print_result(ret);
+	return ret;
+}
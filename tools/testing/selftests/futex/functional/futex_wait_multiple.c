@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ * DESCRIPTION
+ *      Test FUTEX_WAIT_MULTIPLE: it returns -EWOULDBLOCK if one of the
+ *      futexes differs from its expected value, -ETIMEDOUT once the
+ *      absolute timeout passes, and the index of the futex that was woken.
+ *
+ *****************************************************************************/
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "futextest.h"
+#include "logging.h"
+
+#define NR_FUTEXES	16
+#define WAKE_INDEX	11
+#define timeout_ns	100000
+
+static futex_t futexes[NR_FUTEXES];
+static struct futex_wait_block fwb[NR_FUTEXES];
+
+void usage(char *prog)
+{
+	printf("Usage: %s\n", prog);
+	printf("  -c	Use color\n");
+	printf("  -h	Display this help message\n");
+	printf("  -v L	Verbosity level: %d=QUIET %d=CRITICAL %d=INFO\n",
+	       VQUIET, VCRITICAL, VINFO);
+}
+
+void *wakerfn(void *arg)
+{
+	int res;
+
+	/* Spin until the main thread is queued on all the futexes. */
+	do {
+		usleep(1000);
+		res = futex_wake(&futexes[WAKE_INDEX], 1, FUTEX_PRIVATE_FLAG);
+	} while (res == 0);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec to;
+	pthread_t waker;
+	int res, ret = RET_PASS;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "chv:")) != -1) {
+		switch (c) {
+		case 'c':
+			log_color(1);
+			break;
+		case 'h':
+			usage(basename(argv[0]));
+			exit(0);
+		case 'v':
+			log_verbosity(atoi(optarg));
+			break;
+		default:
+			usage(basename(argv[0]));
+			exit(1);
+		}
+	}
+
+	printf("%s: Test FUTEX_WAIT_MULTIPLE\n", basename(argv[0]));
+
+	for (i = 0; i < NR_FUTEXES; i++) {
+		fwb[i].uaddr = (unsigned long)&futexes[i];
+		fwb[i].val = 0;
+		fwb[i].bitset = ~0;
+	}
+
+	info("Calling futex_wait_multiple with a stale value\n");
+	fwb[NR_FUTEXES - 1].val = 1;
+	res = futex_wait_multiple(fwb, NR_FUTEXES, NULL, FUTEX_PRIVATE_FLAG);
+	if (!res || errno != EWOULDBLOCK) {
+		fail("futex_wait_multiple returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		ret = RET_FAIL;
+	}
+	fwb[NR_FUTEXES - 1].val = 0;
+
+	info("Calling futex_wait_multiple with a timeout\n");
+	clock_gettime(CLOCK_MONOTONIC, &to);
+	to.tv_nsec += timeout_ns;
+	if (to.tv_nsec >= 1000000000) {
+		to.tv_sec++;
+		to.tv_nsec -= 1000000000;
+	}
+	res = futex_wait_multiple(fwb, NR_FUTEXES, &to, FUTEX_PRIVATE_FLAG);
+	if (!res || errno != ETIMEDOUT) {
+		fail("futex_wait_multiple returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		ret = RET_FAIL;
+	}
+
+	info("Calling futex_wait_multiple and waking futex %d\n", WAKE_INDEX);
+	if (pthread_create(&waker, NULL, wakerfn, NULL)) {
+		error("pthread_create failed\n", errno);
+		ret = RET_ERROR;
+		goto out;
+	}
+	res = futex_wait_multiple(fwb, NR_FUTEXES, NULL, FUTEX_PRIVATE_FLAG);
+	if (res != WAKE_INDEX) {
+		fail("futex_wait_multiple returned: %d %s\n",
+		     res < 0 ? errno : res, res < 0 ? strerror(errno) : "");
+		ret = RET_FAIL;
+	}
+	pthread_join(waker, NULL);
+
+out:
+	print_result(ret);
+	return ret;
+}
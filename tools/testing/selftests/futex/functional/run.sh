@@ -77,3 +77,9 @@ echo
 echo
 ./futex_wait_uninitialized_heap $COLOR
 ./futex_wait_private_mapped_file $COLOR
+
+echo
+./futex_private_hash $COLOR
+
+echo
+./futex_wait_multiple $COLOR
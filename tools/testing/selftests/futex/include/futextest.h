@@ -50,6 +50,14 @@ typedef volatile u_int32_t futex_t;
 #define FUTEX_CMP_REQUEUE_PI_PRIVATE	(FUTEX_CMP_REQUEUE_PI | \
 					 FUTEX_PRIVATE_FLAG)
 #endif
+#ifndef FUTEX_WAIT_MULTIPLE
+#define FUTEX_WAIT_MULTIPLE		13
+struct futex_wait_block {
+	u_int64_t uaddr;
+	u_int32_t val;
+	u_int32_t bitset;
+};
+#endif
 
 /**
  * futex() - SYS_futex syscall wrapper
@@ -106,6 +114,22 @@ futex_wait_bitset(futex_t *uaddr, futex_t val, struct timespec *timeout,
 		     opflags);
 }
 
+/**
+ * futex_wait_multiple() - block on several futexes with optional timeout
+ * @fwb:	array of futex words, expected values and bitsets
+ * @count:	number of entries in fwb
+ * @timeout:	absolute timeout
+ *
+ * Return the index of the entry that was woken.
+ */
+static inline int
+futex_wait_multiple(struct futex_wait_block *fwb, int count,
+		    struct timespec *timeout, int opflags)
+{
+	return futex(fwb, FUTEX_WAIT_MULTIPLE, count, timeout, NULL, 0,
+		     opflags);
+}
+
 /**
  * futex_wake_bitset() - wake one or more tasks blocked on uaddr with bitset
  * @bitset:	bitset to compare with that used in futex_wait_bitset
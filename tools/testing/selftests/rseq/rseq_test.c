@@ -0,0 +1,208 @@
+#define _GNU_SOURCE
+#include <linux/rseq.h>
+#include <syscall.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "../kselftest.h"
+
+#define RSEQ_SIG	0x53053053
+
+#define NR_THREADS	8
+#define NR_LOOPS	1000000
+#define MAX_CPUS	4096
+
+enum test_rseq_status {
+	TEST_RSEQ_PASS = 0,
+	TEST_RSEQ_FAIL,
+	TEST_RSEQ_SKIP,
+};
+
+static __thread volatile struct rseq rseq_area = {
+	.cpu_id = RSEQ_CPU_ID_UNINITIALIZED,
+};
+
+static int sys_rseq(volatile struct rseq *rseq_abi, uint32_t rseq_len,
+		    int flags, uint32_t sig)
+{
+	return syscall(__NR_rseq, rseq_abi, rseq_len, flags, sig);
+}
+
+static int rseq_register_current_thread(void)
+{
+	return sys_rseq(&rseq_area, sizeof(rseq_area), 0, RSEQ_SIG);
+}
+
+static int rseq_unregister_current_thread(void)
+{
+	return sys_rseq(&rseq_area, sizeof(rseq_area), RSEQ_FLAG_UNREGISTER,
+			RSEQ_SIG);
+}
+
+static enum test_rseq_status test_rseq_register(void)
+{
+	if (rseq_register_current_thread()) {
+		printf("rseq: registration failed. %s.\n", strerror(errno));
+		/*
+		 * It is valid to build a kernel with CONFIG_RSEQ=n.
+		 * However, this skips the tests.
+		 */
+		return errno == ENOSYS ? TEST_RSEQ_SKIP : TEST_RSEQ_FAIL;
+	}
+	if ((int32_t)rseq_area.cpu_id < 0) {
+		printf("rseq: cpu_id not set on registration.\n");
+		return TEST_RSEQ_FAIL;
+	}
+	if (rseq_register_current_thread() != -1 || errno != EBUSY) {
+		printf("rseq: second registration should fail with EBUSY.\n");
+		return TEST_RSEQ_FAIL;
+	}
+	if (sys_rseq(&rseq_area, sizeof(rseq_area), RSEQ_FLAG_UNREGISTER,
+		     ~RSEQ_SIG) != -1 || errno != EPERM) {
+		printf("rseq: unregistration with wrong signature should fail.\n");
+		return TEST_RSEQ_FAIL;
+	}
+	if (rseq_unregister_current_thread()) {
+		printf("rseq: unregistration failed. %s.\n", strerror(errno));
+		return TEST_RSEQ_FAIL;
+	}
+	if (rseq_area.cpu_id != RSEQ_CPU_ID_UNINITIALIZED) {
+		printf("rseq: cpu_id not reset on unregistration.\n");
+		return TEST_RSEQ_FAIL;
+	}
+	printf("rseq: registration success.\n");
+	return TEST_RSEQ_PASS;
+}
+
+#ifdef __x86_64__
+
+struct percpu_count {
+	intptr_t count;
+} __attribute__((aligned(128)));
+
+static struct percpu_count counts[MAX_CPUS];
+
+/*
+ * Increment the counter of 'cpu', unless the thread is no longer running
+ * on it or gets preempted, migrated or signaled before the add commits.
+ * Returns 0 on success, -1 if the caller has to retry.
+ */
+static int rseq_percpu_inc(intptr_t *v, int cpu)
+{
+	__asm__ __volatile__ goto (
+		".pushsection __rseq_cs, \"aw\"\n\t"
+		".balign 32\n\t"
+		"3:\n\t"
+		".long 0x0, 0x0\n\t"
+		".quad 1f, (2f - 1f), 4f\n\t"
+		".popsection\n\t"
+		"leaq 3b(%%rip), %%rax\n\t"
+		"movq %%rax, %[rseq_cs]\n\t"
+		"1:\n\t"
+		"cmpl %[cpu_id], %[current_cpu_id]\n\t"
+		"jnz 4f\n\t"
+		"addq $1, %[v]\n\t"
+		"2:\n\t"
+		".pushsection __rseq_failure, \"ax\"\n\t"
+		".long 0x53053053\n\t"
+		"4:\n\t"
+		"jmp %l[abort]\n\t"
+		".popsection\n\t"
+		: /* gcc asm goto does not allow outputs */
+		: [cpu_id]		"r" (cpu),
+		  [current_cpu_id]	"m" (rseq_area.cpu_id),
+		  [rseq_cs]		"m" (rseq_area.rseq_cs),
+		  [v]			"m" (*v)
+		: "memory", "cc", "rax"
+		: abort
+	);
+	return 0;
+abort:
+	return -1;
+}
+
+static void *percpu_inc_thread(void *arg)
+{
+	long *aborts = arg;
+	int i;
+
+	if (rseq_register_current_thread())
+		abort();
+
+	for (i = 0; i < NR_LOOPS; i++) {
+		int cpu;
+
+		do {
+			cpu = rseq_area.cpu_id_start;
+		} while (rseq_percpu_inc(&counts[cpu].count, cpu) &&
+			 ++*aborts);
+	}
+
+	if (rseq_unregister_current_thread())
+		abort();
+	return NULL;
+}
+
+static enum test_rseq_status test_rseq_percpu_counter(void)
+{
+	pthread_t threads[NR_THREADS];
+	long aborts[NR_THREADS] = {};
+	long total_aborts = 0;
+	intptr_t sum = 0;
+	int i;
+
+	for (i = 0; i < NR_THREADS; i++)
+		if (pthread_create(&threads[i], NULL, percpu_inc_thread,
+				   &aborts[i])) {
+			printf("rseq: pthread_create failed.\n");
+			return TEST_RSEQ_FAIL;
+		}
+	for (i = 0; i < NR_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+		total_aborts += aborts[i];
+	}
+	for (i = 0; i < MAX_CPUS; i++)
+		sum += counts[i].count;
+
+	if (sum != (intptr_t)NR_THREADS * NR_LOOPS) {
+		printf("rseq: per-cpu counter sum %ld, expected %ld.\n",
+		       (long)sum, (long)NR_THREADS * NR_LOOPS);
+		return TEST_RSEQ_FAIL;
+	}
+	printf("rseq: per-cpu counter success, %ld aborts.\n", total_aborts);
+	return TEST_RSEQ_PASS;
+}
+
+#else
+
+static enum test_rseq_status test_rseq_percpu_counter(void)
+{
+	return TEST_RSEQ_PASS;
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+	switch (test_rseq_register()) {
+	case TEST_RSEQ_FAIL:
+		return ksft_exit_fail();
+	case TEST_RSEQ_SKIP:
+		return ksft_exit_skip();
+	}
+	switch (test_rseq_percpu_counter()) {
+	case TEST_RSEQ_FAIL:
+		return ksft_exit_fail();
+	case TEST_RSEQ_SKIP:
+		return ksft_exit_skip();
+	}
+
+	printf("rseq: tests done!\n");
+	return ksft_exit_pass();
+}
@@ -0,0 +1,200 @@
+/*
+ * Test that page tables shared on fork with PR_SET_LAZY_FORK keep parent
+ * and child isolated, also across munmap(), mprotect() and MADV_DONTNEED
+ * of parts of the shared range.  Also check that rmap walks of hugetlb
+ * pages, which are never shared that way, keep working.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+#ifndef PR_SET_LAZY_FORK
+#define PR_SET_LAZY_FORK	50
+#define PR_GET_LAZY_FORK	51
+#endif
+
+#ifndef MADV_SOFT_OFFLINE
+#define MADV_SOFT_OFFLINE	101
+#endif
+
+#define MAP_LEN		(64UL << 20)
+#define PMD_LEN		(2UL << 20)
+
+static unsigned long page_size;
+
+static int check(char *p, unsigned long len, char val, const char *who)
+{
+	unsigned long i;
+
+	for (i = 0; i < len; i += page_size) {
+		if (p[i] != val) {
+			printf("%s: offset %lx is %d, expected %d\n",
+			       who, i, p[i], val);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int child(char *p)
+{
+	char *mid = p + MAP_LEN / 2;
+
+	if (check(p, MAP_LEN, 1, "child before write"))
+		return 1;
+
+	/* a write copies one table, the rest stay shared */
+	memset(p, 2, PMD_LEN);
+	if (check(p, PMD_LEN, 2, "child after write") ||
+	    check(p + PMD_LEN, MAP_LEN - PMD_LEN, 1, "child after write"))
+		return 1;
+
+	/* boundaries in the middle of shared tables */
+	if (munmap(mid + page_size, page_size)) {
+		perror("munmap");
+		return 1;
+	}
+	if (mprotect(mid + PMD_LEN + page_size, page_size, PROT_READ)) {
+		perror("mprotect");
+		return 1;
+	}
+	if (madvise(mid + 2 * PMD_LEN + page_size, page_size, MADV_DONTNEED)) {
+		perror("madvise");
+		return 1;
+	}
+	if (check(mid + 2 * PMD_LEN + page_size, page_size, 0,
+		  "child after MADV_DONTNEED"))
+		return 1;
+
+	/* drop whole shared tables */
+	if (munmap(mid + 4 * PMD_LEN, 4 * PMD_LEN)) {
+		perror("munmap");
+		return 1;
+	}
+
+	memset(mid - 4 * PMD_LEN, 3, 2 * PMD_LEN);
+	return check(mid - 4 * PMD_LEN, 2 * PMD_LEN, 3, "child at exit");
+}
+
+/*
+ * Soft offlining migrates the hugetlb page, which walks its rmap through
+ * both the parent and the child mapping it.
+ */
+static int hugetlb_test(void)
+{
+	int status, ret = 0;
+	char *p;
+	pid_t pid;
+
+	p = mmap(NULL, PMD_LEN, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p == MAP_FAILED) {
+		printf("no hugetlb pages, skipping hugetlb test\n");
+		return 0;
+	}
+	memset(p, 5, PMD_LEN);
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (!pid) {
+		sleep(1);
+		exit(check(p, PMD_LEN, 5, "hugetlb child"));
+	}
+
+	if (madvise(p, PMD_LEN, MADV_SOFT_OFFLINE))
+		printf("MADV_SOFT_OFFLINE: %s, rmap walk not tested\n",
+		       strerror(errno));
+
+	if (waitpid(pid, &status, 0) != pid) {
+		perror("waitpid");
+		return 1;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		printf("[FAIL] hugetlb child\n");
+		ret = 1;
+	}
+	if (check(p, PMD_LEN, 5, "hugetlb parent"))
+		ret = 1;
+
+	munmap(p, PMD_LEN);
+	return ret;
+}
+
+int main(void)
+{
+	int status, ret = 0;
+	unsigned long off;
+	char *map, *p;
+	pid_t pid;
+
+	page_size = getpagesize();
+
+	if (prctl(PR_SET_LAZY_FORK, 1, 0, 0, 0)) {
+		if (errno == EINVAL) {
+			printf("PR_SET_LAZY_FORK not supported, skipping\n");
+			return 0;
+		}
+		perror("prctl(PR_SET_LAZY_FORK)");
+		return 1;
+	}
+	if (prctl(PR_GET_LAZY_FORK, 0, 0, 0, 0) != 1) {
+		printf("PR_GET_LAZY_FORK doesn't return 1\n");
+		return 1;
+	}
+
+	map = mmap(NULL, MAP_LEN + PMD_LEN, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	/* align to a pmd so that the tables can be shared */
+	p = (char *)(((unsigned long)map + PMD_LEN - 1) & ~(PMD_LEN - 1));
+	madvise(p, MAP_LEN, MADV_NOHUGEPAGE);
+	memset(p, 1, MAP_LEN);
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (!pid)
+		exit(child(p));
+
+	/* write to some tables while the child uses them as well */
+	for (off = 0; off < MAP_LEN; off += 4 * PMD_LEN)
+		p[off + PMD_LEN] = 4;
+
+	if (waitpid(pid, &status, 0) != pid) {
+		perror("waitpid");
+		return 1;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		printf("[FAIL] child\n");
+		ret = 1;
+	}
+
+	for (off = 0; off < MAP_LEN; off += 4 * PMD_LEN)
+		if (p[off + PMD_LEN] != 4) {
+			printf("parent: offset %lx changed\n", off + PMD_LEN);
+			ret = 1;
+		}
+	for (off = 0; off < MAP_LEN; off += PMD_LEN)
+		if (check(p + off + page_size, PMD_LEN - page_size, 1,
+			  "parent"))
+			ret = 1;
+
+	if (hugetlb_test())
+		ret = 1;
+
+	printf("%s\n", ret ? "[FAIL]" : "[PASS]");
+	return ret;
+}